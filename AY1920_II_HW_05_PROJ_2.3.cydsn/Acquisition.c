@@ -0,0 +1,1048 @@
+/*
+* This file includes the source code of the double buffered
+* acquisition pipeline.
+*/
+
+#include "Acquisition.h"
+#include "Calibration.h"
+#include "Capture.h"
+#include "Clock.h"
+#include "Features.h"
+#include "Filter.h"
+#include "FixedMath.h"
+#include "I2C_Interface.h"
+#include "Impact.h"
+#include "Motion.h"
+#include "RamCode.h"
+#include "Spectrum.h"
+#include "Stream.h"
+#include "Timing.h"
+
+/**
+*   \brief Phases of the drain of a sensor.
+*/
+#define ACQ_PHASE_IDLE 0    ///< No transfer in progress
+#define ACQ_PHASE_STATUS 1  ///< Reading FIFO_SRC_REG
+#define ACQ_PHASE_DATA 2    ///< Reading the samples
+
+/**
+*   \brief Levels of the adaptive data rate.
+*/
+#define ACQ_LEVEL_LOW 0     ///< ACQ_IDLE_ODR
+#define ACQ_LEVEL_NORMAL 1  ///< Data rate set with ACQ_CONFIG_ODR
+#define ACQ_LEVEL_HIGH 2    ///< ACQ_MOTION_HIGH_ODR, or ACQ_CONFIG_ODR when faster
+
+/**
+*   \brief Buffer of the ping-pong pair.
+*/
+typedef struct {
+    uint8_t data[ACQ_DRAIN_SAMPLES * LIS3DH_SAMPLE_SIZE];  // LSB and MSB of the X,Y and then Z axis
+    uint8_t samples;                                        // Samples waiting to be encoded
+    LIS3DH_Handle* dev;                                     // Sensor that produced the samples
+} AcqBuffer;
+
+/**
+*   \brief Preset of the filter and decimation stage.
+*/
+typedef struct {
+    uint8_t odr;                    // Data rate of the sensors, LIS3DH_ODR_POWER_DOWN to keep the current one
+    const Filter_Biquad* coeffs;    // Sections of the low pass filter
+    uint8_t stages;                 // Number of sections
+    uint8_t decimation;             // Decimation factor
+} AcqFilterPreset;
+
+static const Filter_Biquad lp50[2] = ACQ_FILTER_LP50_SECTIONS;
+static const Filter_Biquad lp30[2] = ACQ_FILTER_LP30_SECTIONS;
+
+static const AcqFilterPreset presets[ACQ_FILTER_PRESETS] = {
+    { LIS3DH_ODR_POWER_DOWN, NULL, 0, 1 },  // ACQ_FILTER_NONE
+    { LIS3DH_ODR_1344HZ, lp50, 2, 8 },      // ACQ_FILTER_LP50_D8
+    { LIS3DH_ODR_1344HZ, lp30, 2, 12 },     // ACQ_FILTER_LP30_D12
+};
+
+static LIS3DH_Handle* sensors;
+static uint8_t sensor_count;
+
+static AcqBuffer buffers[2];    // Ping-pong pair
+static uint8_t fill;            // Buffer filled by the I2C interface, the other one is encoded
+static uint8_t phase;           // One of the ACQ_PHASE_xxx values
+static uint8_t current;         // Sensor being drained
+static uint8_t pending;         // Samples requested by the transfer in progress
+static uint8_t backlog;         // Set if some FIFO had more samples than a single drain in this round
+static uint16_t aux_samples;    // Samples of the first sensor since the last auxiliary reading
+
+static uint8_t batch;           // Samples drained from a sensor at a time
+static uint8_t format;          // One of the ACQ_FORMAT_xxx values
+static uint8_t streaming;       // Cleared to pause the drains
+static uint8_t config_item;     // Setting waiting for the end of the round, 0 if none
+static uint8_t config_value;    // New value of the setting
+
+static Filter filters[LIS3DH_MAX_DEVICES];  // Filter and decimation stage of every sensor
+static Spectrum spectra[LIS3DH_MAX_DEVICES];    // Window of the spectrum of every sensor
+static Features features[LIS3DH_MAX_DEVICES];   // Statistics of the window of every sensor
+static uint16_t window;                         // Samples of the window of the features
+static Impact impacts[LIS3DH_MAX_DEVICES];      // Impact detection of every sensor
+static uint16_t impact_threshold;               // Magnitude that starts an impact in mg, 0 if disabled
+
+static Motion motions[LIS3DH_MAX_DEVICES];      // Motion energy of every sensor
+static uint8_t adaptive;        // Motion threshold in units of ACQ_MOTION_UNIT_MG, 0 if the data rate is fixed
+static uint8_t level;           // One of the ACQ_LEVEL_xxx values
+static uint8_t quiet_windows;   // Consecutive windows below the current level
+static uint32_t last_window;    // Cycle counter at the beginning of the motion window
+
+static uint8_t activity;        // Threshold of the activity detection, 0 to stream continuously
+static uint8_t idle;            // Set while waiting for activity at the idle data rate
+static uint8_t pretrigger;      // Set while the history collected in idle is drained
+static uint8_t active_odr;      // Data rate of the sensors while streaming
+static uint32_t last_activity;  // Cycle counter at the last activity event
+static uint32_t last_poll;      // Cycle counter at the last poll in idle
+static uint8_t capture;         // Set while the capture of transients replaces the streaming
+static uint8_t low_power;       // Set if the sensors run in the 8 bit low power mode
+
+static uint32_t last_status[LIS3DH_MAX_DEVICES];    // Cycle counter at the last read of FIFO_SRC_REG
+static uint8_t remaining[LIS3DH_MAX_DEVICES];       // Samples left in the FIFO by the last drain
+static uint8_t tracked;                             // Sensors whose FIFO has been drained without interruption
+static uint32_t lost_overrun;                       // Samples lost by the FIFOs of the sensors
+static uint32_t lost_i2c;                           // Samples lost by failed reads
+static uint32_t acquired;                           // Samples read from the FIFOs
+static uint32_t sent;                               // Samples given to the output format, after the decimation
+static uint32_t shed;                               // Samples not sent by the flow control
+static uint32_t encode_cycles;                      // Cycles spent encoding the samples read
+
+static uint8_t flow;                // One of the ACQ_FLOW_xxx levels
+static uint8_t pressure_count;      // Consecutive buffers with the ring above ACQ_FLOW_SHED_BYTES
+static uint8_t release_count;       // Consecutive buffers with the ring below ACQ_FLOW_RELEASE_BYTES
+static uint8_t shed_phase;          // Position of the sample in the ACQ_FLOW_SHED_RATIO group
+
+/**
+*   \brief Collect a sample in the window of the sensor, send the spectra when it is full.
+*/
+static void Acquisition_AddToSpectrum(LIS3DH_Handle* dev, const uint8_t* sample)
+{
+    uint8_t bins[SPECTRUM_BINS];
+
+    if (Spectrum_Add(&spectra[dev - sensors], sample))
+    {
+        for (uint8_t axis = 0; axis < SPECTRUM_AXES; axis++)
+        {
+            Spectrum_Compute(&spectra[dev - sensors], axis, bins);
+            Stream_SendSpectrum(dev->channel, axis, bins, SPECTRUM_BINS);
+        }
+    }
+}
+
+/**
+*   \brief Send pitch and roll of a sample, from the calibrated gravity vector.
+*/
+static void Acquisition_SendTilt(LIS3DH_Handle* dev, const Calibration_Axis* axes, const uint8_t* sample)
+{
+    int32_t acc[3];
+    uint32_t yz;
+
+    Calibration_Convert(axes, sample, acc);
+
+    // The length of the Y-Z projection comes out of the roll iterations, no square root is needed
+    int16_t roll = FixedMath_Atan2(acc[1], acc[2], &yz);
+    int16_t pitch = FixedMath_Atan2(-acc[0], (int32_t)yz, NULL);
+
+    Stream_SendTilt(dev->channel, pitch, roll);
+}
+
+/**
+*   \brief Choose the level of the flow control from the occupancy of the UART ring.
+*
+*   Called before every buffer is encoded. Compact at once, shed and recover
+*   only when the occupancy is sustained.
+*/
+static void Acquisition_UpdateFlow(void)
+{
+    uint16_t waiting = (STREAM_TX_BUFFER_SIZE - 1) - Stream_TxFree();
+    uint8_t target = flow;
+
+    if (waiting >= ACQ_FLOW_SHED_BYTES)
+    {
+        release_count = 0;
+        if (pressure_count < ACQ_FLOW_SHED_BUFFERS)
+        {
+            pressure_count++;
+        }
+        if (pressure_count >= ACQ_FLOW_SHED_BUFFERS)
+        {
+            target = ACQ_FLOW_SHED;
+        }
+        else if (flow < ACQ_FLOW_COMPACT)
+        {
+            target = ACQ_FLOW_COMPACT;
+        }
+    }
+    else if (waiting >= ACQ_FLOW_COMPACT_BYTES)
+    {
+        pressure_count = 0;
+        release_count = 0;
+        if (flow < ACQ_FLOW_COMPACT)
+        {
+            target = ACQ_FLOW_COMPACT;
+        }
+    }
+    else
+    {
+        pressure_count = 0;
+        if (waiting >= ACQ_FLOW_RELEASE_BYTES || flow == ACQ_FLOW_NORMAL)
+        {
+            release_count = 0;
+        }
+        else if (++release_count >= ACQ_FLOW_RELEASE_BUFFERS)
+        {
+            release_count = 0;
+            target = flow - 1;
+        }
+    }
+
+    if (target != flow)
+    {
+        flow = target;
+        Stream_SendEvent(0, STREAM_EVENT_FLOW, flow);
+    }
+}
+
+/**
+*   \brief Encode the samples of a buffer and queue them for the UART.
+*/
+RAM_CODE static void Acquisition_Encode(AcqBuffer* buffer)
+{
+    // A buffer never filled has no sensor yet
+    if (buffer->samples == 0)
+    {
+        return;
+    }
+
+    uint32_t start = Timing_Now();
+    uint32_t stalled = Stream_GetStallCycles();
+    Filter* filter = &filters[buffer->dev - sensors];
+    uint8_t sensitivity = LIS3DH_GetSensitivity(buffer->dev);
+    const Calibration_Axis* axes = Calibration_Get(buffer->dev->channel, sensitivity);
+    uint8_t kept = 0;
+    uint8_t packed = 0;
+
+    // Peaks and motion are taken from all the samples, before the filter smooths them
+    for (uint8_t i = 0; (impact_threshold || adaptive) && i < buffer->samples; i++)
+    {
+        const uint8_t* sample = &buffer->data[i * LIS3DH_SAMPLE_SIZE];
+        Impact_Event event;
+
+        if (impact_threshold &&
+            Impact_Add(&impacts[buffer->dev - sensors], sample, sensitivity, impact_threshold, &event))
+        {
+            Stream_SendImpact(buffer->dev->channel, event.peak, event.duration, event.timestamp);
+        }
+        if (adaptive)
+        {
+            Motion_Add(&motions[buffer->dev - sensors], sample, sensitivity);
+        }
+    }
+
+    // The decimated samples are compacted at the beginning of the buffer
+    for (uint8_t i = 0; i < buffer->samples; i++)
+    {
+        kept += Filter_Process(filter, &buffer->data[i * LIS3DH_SAMPLE_SIZE], &buffer->data[kept * LIS3DH_SAMPLE_SIZE]);
+    }
+
+    // Features and spectra need all the samples of their windows and are already compact
+    uint8_t per_sample = (format == ACQ_FORMAT_SI || format == ACQ_FORMAT_RAW ||
+                          format == ACQ_FORMAT_TILT || format == ACQ_FORMAT_RAW8);
+
+    if (kept > 0)
+    {
+        Acquisition_UpdateFlow();
+    }
+
+    for (uint8_t i = 0; i < kept; i++)
+    {
+        if (flow == ACQ_FLOW_SHED && per_sample && (shed_phase++ % ACQ_FLOW_SHED_RATIO) != 0)
+        {
+            shed++;
+            continue;
+        }
+        sent++;
+
+        if (format == ACQ_FORMAT_FEATURES)
+        {
+            Features_Axis result[FEATURES_AXES];
+
+            if (Features_Add(&features[buffer->dev - sensors], &buffer->data[i * LIS3DH_SAMPLE_SIZE], window, result))
+            {
+                Stream_SendFeatures(buffer->dev->channel, result);
+            }
+        }
+        else if (format == ACQ_FORMAT_SPECTRUM)
+        {
+            Acquisition_AddToSpectrum(buffer->dev, &buffer->data[i * LIS3DH_SAMPLE_SIZE]);
+        }
+        else if (format == ACQ_FORMAT_TILT)
+        {
+            Acquisition_SendTilt(buffer->dev, axes, &buffer->data[i * LIS3DH_SAMPLE_SIZE]);
+        }
+        else if (format == ACQ_FORMAT_RAW8)
+        {
+            // Packed in place, the packed samples never reach the ones still to be read
+            LIS3DH_PackSample(&buffer->data[i * LIS3DH_SAMPLE_SIZE], &buffer->data[packed * LIS3DH_PACKED_SAMPLE_SIZE]);
+            packed++;
+        }
+        else if (format == ACQ_FORMAT_RAW || flow != ACQ_FLOW_NORMAL)
+        {
+            Stream_SendRaw(buffer->dev->channel, &buffer->data[i * LIS3DH_SAMPLE_SIZE]);
+        }
+        else
+        {
+            Stream_SendAcc(buffer->dev->channel, axes, &buffer->data[i * LIS3DH_SAMPLE_SIZE]);
+        }
+    }
+    if (packed > 0)
+    {
+        Stream_SendRaw8(buffer->dev->channel, buffer->data, packed);
+    }
+    // The waits for room in the ring are the UART, not the encoding
+    encode_cycles += Timing_Elapsed(start) - (Stream_GetStallCycles() - stalled);
+    buffer->samples = 0;
+}
+
+/**
+*   \brief Send a gap marker after the samples already acquired.
+*/
+static void Acquisition_SendGap(LIS3DH_Handle* dev, uint8_t cause, uint32_t lost)
+{
+    // The older buffer first, the marker must follow all the samples before the gap
+    Acquisition_Encode(&buffers[fill]);
+    Acquisition_Encode(&buffers[fill ^ 1]);
+
+    Stream_SendGap(dev->channel, cause, lost);
+}
+
+/**
+*   \brief Check the overrun of the FIFO of the sensor being drained.
+*
+*   The FIFO only says that it overflowed, not how many samples were
+*   overwritten: they are estimated from the data rate and the time since
+*   the previous drain.
+*/
+static void Acquisition_CheckOverrun(void)
+{
+    LIS3DH_Handle* dev = &sensors[current];
+    uint32_t now = Timing_Now();
+
+    if ((tracked & (1 << current)) && (dev->fifo_src & LIS3DH_FIFO_SRC_OVRN))
+    {
+        uint32_t produced = ((uint64_t)(now - last_status[current]) * LIS3DH_GetDataRateHz(dev)) / Clock_GetHz();
+        int32_t lost = (int32_t)(remaining[current] + produced) - LIS3DH_FIFO_SIZE;
+
+        if (lost > 0)
+        {
+            lost_overrun += lost;
+            Acquisition_SendGap(dev, STREAM_GAP_OVERRUN, lost);
+        }
+    }
+
+    last_status[current] = now;
+    tracked |= 1 << current;
+}
+
+/**
+*   \brief Read the slow channels of all the sensors.
+*
+*   Called at the end of a round, when no transfer is in progress.
+*/
+static void Acquisition_ReadAux(void)
+{
+    int16_t AuxData[LIS3DH_AUX_CHANNELS];  // ADC1, ADC2 and temperature
+
+    for (uint8_t s = 0; s < sensor_count; s++)
+    {
+        if (LIS3DH_ReadAux(&sensors[s], AuxData) == NO_ERROR)
+        {
+            Stream_SendAux(sensors[s].channel, AuxData);
+        }
+    }
+}
+
+/**
+*   \brief Write the data rate of all the sensors.
+*/
+static void Acquisition_WriteDataRate(uint8_t odr)
+{
+    for (uint8_t s = 0; s < sensor_count; s++)
+    {
+        LIS3DH_SetDataRate(&sensors[s], odr);
+        LIS3DH_Commit(&sensors[s]);     // A failed write stays dirty and is retried by the next commit
+    }
+}
+
+/**
+*   \brief Change the data rate used while streaming.
+*
+*   In idle the new rate is only stored, it is written when activity is detected.
+*/
+static void Acquisition_SetDataRate(uint8_t odr)
+{
+    active_odr = odr;
+
+    if (!idle && level == ACQ_LEVEL_NORMAL)
+    {
+        Acquisition_WriteDataRate(odr);
+    }
+}
+
+/**
+*   \brief Move the sensors to a level of the adaptive data rate and tag the change.
+*/
+static void Acquisition_SetLevel(uint8_t new_level)
+{
+    static const uint8_t level_odr[3] = { ACQ_IDLE_ODR, 0, ACQ_MOTION_HIGH_ODR };
+    uint8_t odr = (new_level == ACQ_LEVEL_NORMAL) ? active_odr : level_odr[new_level];
+
+    // The codes of CTRL_REG1 grow with the rate, motion never slows down a faster ACQ_CONFIG_ODR
+    if (new_level == ACQ_LEVEL_HIGH && active_odr > odr)
+    {
+        odr = active_odr;
+    }
+
+    // The samples already read were taken at the old rate, they go before the tag
+    Acquisition_Encode(&buffers[fill]);
+    Acquisition_Encode(&buffers[fill ^ 1]);
+
+    level = new_level;
+    tracked = 0;
+    Acquisition_WriteDataRate(odr);     // Only CTRL_REG1 is written, the other registers are cached
+    Stream_SendEvent(0, STREAM_EVENT_RATE, odr);
+}
+
+/**
+*   \brief Choose the level of the adaptive data rate at the end of a motion window.
+*
+*   Called at the end of a round, when no transfer is in progress.
+*/
+static void Acquisition_AdaptRate(void)
+{
+    uint32_t energy = 0;
+
+    if (Timing_Elapsed(last_window) < TIMING_US_TO_CYCLES(ACQ_MOTION_WINDOW_US))
+    {
+        return;
+    }
+    last_window = Timing_Now();
+
+    // The sensor that moves the most drives the rate of all of them
+    for (uint8_t s = 0; s < sensor_count; s++)
+    {
+        uint32_t sensor_energy = Motion_Energy(&motions[s]);
+
+        if (sensor_energy > energy)
+        {
+            energy = sensor_energy;
+        }
+    }
+
+    uint32_t threshold = (uint32_t)adaptive * ACQ_MOTION_UNIT_MG;
+    uint32_t high = threshold * threshold;
+    uint8_t target;
+
+    if (energy >= high)
+    {
+        target = ACQ_LEVEL_HIGH;
+    }
+    else if (energy >= high / 16)   // A quarter of the RMS threshold
+    {
+        target = ACQ_LEVEL_NORMAL;
+    }
+    else
+    {
+        target = ACQ_LEVEL_LOW;
+    }
+
+    // Up at once, so the beginning of an event isn't lost, down slowly and one level at a time
+    if (target > level)
+    {
+        quiet_windows = 0;
+        Acquisition_SetLevel(target);
+    }
+    else if (target < level && ++quiet_windows >= ACQ_MOTION_HOLD_WINDOWS)
+    {
+        quiet_windows = 0;
+        Acquisition_SetLevel(level - 1);
+    }
+    else if (target == level)
+    {
+        quiet_windows = 0;
+    }
+}
+
+/**
+*   \brief Look for activity on all the sensors, in idle.
+*
+*   The FIFOs are not drained in idle, so when activity is detected they
+*   hold the samples that preceded the event, at the idle data rate. They
+*   are streamed first and the data rate is raised afterwards.
+*/
+static void Acquisition_PollActivity(void)
+{
+    if (Timing_Elapsed(last_poll) < TIMING_US_TO_CYCLES(ACQ_IDLE_POLL_US))
+    {
+        return;
+    }
+    last_poll = Timing_Now();
+
+    for (uint8_t s = 0; s < sensor_count; s++)
+    {
+        uint8_t event;
+
+        if (LIS3DH_ReadActivity(&sensors[s], &event) == NO_ERROR && event)
+        {
+            idle = 0;
+            pretrigger = 1;
+            tracked = 0;    // The history overflowed the FIFOs on purpose
+            last_activity = last_poll;
+            Stream_SendEvent(sensors[s].channel, STREAM_EVENT_ACTIVE, ACQ_IDLE_ODR);
+            return;
+        }
+    }
+}
+
+/**
+*   \brief Keep track of the activity at the end of a round, while streaming.
+*/
+static void Acquisition_CheckActivity(void)
+{
+    for (uint8_t s = 0; s < sensor_count; s++)
+    {
+        uint8_t event;
+
+        if (LIS3DH_ReadActivity(&sensors[s], &event) == NO_ERROR && event)
+        {
+            last_activity = Timing_Now();
+        }
+    }
+
+    if (pretrigger)
+    {
+        // The history has been drained, from now on the samples are at full rate
+        pretrigger = 0;
+        tracked = 0;
+        Acquisition_WriteDataRate(active_odr);
+        Stream_SendEvent(0, STREAM_EVENT_RATE, active_odr);
+    }
+    else if (Timing_Elapsed(last_activity) > TIMING_US_TO_CYCLES(ACQ_QUIET_US))
+    {
+        idle = 1;
+        last_poll = Timing_Now();
+        Acquisition_WriteDataRate(ACQ_IDLE_ODR);
+        Stream_SendEvent(0, STREAM_EVENT_IDLE, ACQ_IDLE_ODR);
+    }
+}
+
+/**
+*   \brief Configure the activity detection of all the sensors.
+*
+*   \param threshold Threshold in LSB of INT1_THS, 0 to stream continuously.
+*/
+static void Acquisition_SetActivity(uint8_t threshold)
+{
+    activity = threshold;
+
+    for (uint8_t s = 0; s < sensor_count; s++)
+    {
+        LIS3DH_SetActivity(&sensors[s], activity, ACQ_ACTIVITY_DURATION);
+        LIS3DH_Commit(&sensors[s]);
+    }
+    last_activity = Timing_Now();   // The quiet period starts now
+
+    if (!activity && idle)
+    {
+        idle = 0;
+        Acquisition_WriteDataRate(active_odr);
+        Stream_SendEvent(0, STREAM_EVENT_RATE, active_odr);
+    }
+}
+
+/**
+*   \brief Run a step of the calibration and report the status.
+*
+*   Measuring a position blocks the stream until the samples have been averaged.
+*/
+static void Acquisition_Calibrate(uint8_t step)
+{
+    if (step < CALIBRATION_POSITIONS)
+    {
+        Calibration_Measure(sensors, sensor_count, step);
+    }
+    else if (step == CALIBRATION_SAVE)
+    {
+        Calibration_Save();
+    }
+    else
+    {
+        Calibration_Clear();
+    }
+
+    // A failed step leaves its bit clear, or CALIBRATION_STORED if the flash wasn't written
+    Stream_SendEvent(0, STREAM_EVENT_CALIBRATION, Calibration_GetStatus());
+}
+
+/**
+*   \brief Apply the setting waiting for the end of the round.
+*
+*   Called when no transfer is in progress. The samples still in the buffers
+*   are encoded first, so they keep the format and sensitivity they were
+*   acquired with.
+*/
+static void Acquisition_ApplyConfig(void)
+{
+    Acquisition_Encode(&buffers[fill]);
+    Acquisition_Encode(&buffers[fill ^ 1]);
+    tracked = 0;    // The FIFOs may not be drained for a while or change rate, overruns are not losses
+
+    switch (config_item)
+    {
+        case ACQ_CONFIG_ODR:
+            Acquisition_SetDataRate(config_value);
+            break;
+
+        case ACQ_CONFIG_FSR:
+            for (uint8_t s = 0; s < sensor_count; s++)
+            {
+                LIS3DH_SetFullScale(&sensors[s], config_value);
+                LIS3DH_Commit(&sensors[s]); // A failed write stays dirty and is retried by the next commit
+            }
+            break;
+
+        case ACQ_CONFIG_BATCH:
+            batch = config_value;
+            break;
+
+        case ACQ_CONFIG_FORMAT:
+            format = config_value;
+            for (uint8_t s = 0; s < sensor_count; s++)
+            {
+                Spectrum_Init(&spectra[s]);
+                Features_Init(&features[s]);
+            }
+            break;
+
+        case ACQ_CONFIG_WINDOW:
+            window = config_value * ACQ_WINDOW_UNIT;
+            for (uint8_t s = 0; s < sensor_count; s++)
+            {
+                Features_Init(&features[s]);
+            }
+            break;
+
+        case ACQ_CONFIG_STREAM:
+            streaming = config_value;
+            break;
+
+        case ACQ_CONFIG_FILTER:
+            for (uint8_t s = 0; s < sensor_count; s++)
+            {
+                Filter_Init(&filters[s], presets[config_value].coeffs,
+                            presets[config_value].stages, presets[config_value].decimation);
+            }
+            if (presets[config_value].odr != LIS3DH_ODR_POWER_DOWN)
+            {
+                Acquisition_SetDataRate(presets[config_value].odr);
+            }
+            break;
+
+        case ACQ_CONFIG_CAPTURE:
+            capture = config_value;
+            if (capture)
+            {
+                Capture_Start(sensors, sensor_count, capture);
+            }
+            else
+            {
+                Capture_Stop();
+                Acquisition_SetActivity(activity);  // The interrupt generator is shared with the capture
+            }
+            break;
+
+        case ACQ_CONFIG_ACTIVITY:
+            Acquisition_SetActivity(config_value);
+            break;
+
+        case ACQ_CONFIG_CALIBRATE:
+            Acquisition_Calibrate(config_value);
+            break;
+
+        case ACQ_CONFIG_IMPACT:
+            impact_threshold = config_value * ACQ_IMPACT_UNIT_MG;
+            for (uint8_t s = 0; s < sensor_count; s++)
+            {
+                Impact_Init(&impacts[s]);
+            }
+            break;
+
+        case ACQ_CONFIG_ADAPTIVE:
+            adaptive = config_value;
+            for (uint8_t s = 0; s < sensor_count; s++)
+            {
+                Motion_Init(&motions[s]);
+            }
+            quiet_windows = 0;
+            last_window = Timing_Now();
+            if (level != ACQ_LEVEL_NORMAL)
+            {
+                Acquisition_SetLevel(ACQ_LEVEL_NORMAL);     // Every change starts from the configured rate
+            }
+            break;
+
+        case ACQ_CONFIG_CLOCK:
+            Clock_SetProfile(config_value);     // No transfer in progress, the bus can be stopped
+            break;
+
+        case ACQ_CONFIG_LOW_POWER:
+            low_power = config_value;
+            for (uint8_t s = 0; s < sensor_count; s++)
+            {
+                LIS3DH_SetLowPower(&sensors[s], low_power);
+                LIS3DH_Commit(&sensors[s]);
+            }
+            break;
+    }
+    config_item = 0;
+}
+
+/**
+*   \brief Move to the next sensor, at the end of a round serve the slow channels.
+*/
+static void Acquisition_NextSensor(void)
+{
+    phase = ACQ_PHASE_IDLE;
+
+    if (++current < sensor_count)
+    {
+        return;
+    }
+    current = 0;
+
+    // The slow channels only use the bus when the FIFOs have been emptied,
+    //      so they never delay the accelerometer acquisition
+    if (aux_samples >= ACQ_AUX_PERIOD_SAMPLES * filters[0].decimation && !backlog)
+    {
+        aux_samples = 0;
+        Acquisition_ReadAux();
+    }
+    if (activity && !backlog)
+    {
+        Acquisition_CheckActivity();
+    }
+    if (adaptive && !backlog)
+    {
+        Acquisition_AdaptRate();
+    }
+    backlog = 0;
+
+    if (config_item)
+    {
+        Acquisition_ApplyConfig();
+    }
+}
+
+/**
+*   \brief Start reading the FIFO status of the current sensor, unless the drains are stopped.
+*
+*   \return 1 if the transfer has been started.
+*/
+RAM_CODE static uint8_t Acquisition_StartDrain(void)
+{
+    if (!streaming || idle || capture)
+    {
+        return 0;
+    }
+    LIS3DH_StartReadFifoStatus(&sensors[current]);
+    phase = ACQ_PHASE_STATUS;
+
+    return 1;
+}
+
+void Acquisition_Start(LIS3DH_Handle* configured_sensors, uint8_t configured_count)
+{
+    sensors = configured_sensors;
+    sensor_count = configured_count;
+    fill = 0;
+    phase = ACQ_PHASE_IDLE;
+    current = 0;
+    backlog = 0;
+    aux_samples = 0;
+    buffers[0].samples = 0;
+    buffers[1].samples = 0;
+    batch = ACQ_DRAIN_SAMPLES;
+    format = ACQ_FORMAT_SI;
+    window = ACQ_WINDOW_DEFAULT * ACQ_WINDOW_UNIT;
+    activity = 0;
+    capture = 0;
+    impact_threshold = 0;
+    adaptive = 0;
+    level = ACQ_LEVEL_NORMAL;
+    idle = 0;
+    tracked = 0;
+    lost_overrun = 0;
+    lost_i2c = 0;
+    acquired = 0;
+    sent = 0;
+    shed = 0;
+    encode_cycles = 0;
+    flow = ACQ_FLOW_NORMAL;
+    pressure_count = 0;
+    release_count = 0;
+    shed_phase = 0;
+    pretrigger = 0;
+    active_odr = (sensor_count > 0) ? LIS3DH_GetRegister(&sensors[0], LIS3DH_CTRL_REG1) & LIS3DH_CTRL_REG1_ODR_MASK : 0;
+    low_power = (sensor_count > 0) && LIS3DH_IsLowPower(&sensors[0]);
+    streaming = 1;
+    config_item = 0;
+
+    for (uint8_t s = 0; s < sensor_count; s++)
+    {
+        Filter_Init(&filters[s], NULL, 0, 1);   // No filter until a preset is selected
+        Spectrum_Init(&spectra[s]);
+        Features_Init(&features[s]);
+    }
+}
+
+/**
+*   \brief Check if a setting is applied to the sensors or to their processing.
+*/
+static uint8_t Acquisition_UsesSensors(uint8_t item)
+{
+    switch (item)
+    {
+        case ACQ_CONFIG_BATCH:
+        case ACQ_CONFIG_FORMAT:
+        case ACQ_CONFIG_WINDOW:
+        case ACQ_CONFIG_STREAM:
+        case ACQ_CONFIG_CLOCK:
+            return 0;
+
+        default:
+            return 1;
+    }
+}
+
+ErrorCode Acquisition_Configure(uint8_t item, uint8_t value)
+{
+    uint8_t valid;
+
+    switch (item)
+    {
+        // The capture saves CTRL_REG1 and CTRL_REG4 and restores them when it stops,
+        //      so the settings that write them must wait for its end
+        case ACQ_CONFIG_ODR:
+            valid = (value & ~LIS3DH_CTRL_REG1_ODR_MASK) == 0 &&
+                    value >= LIS3DH_ODR_1HZ && value <= LIS3DH_ODR_1344HZ &&
+                    (value != LIS3DH_ODR_1600HZ_LP || low_power) && !capture &&
+                    (sensor_count == 0 || filters[0].decimation == 1);   // The presets are designed for their own rate
+            break;
+
+        case ACQ_CONFIG_FSR:
+            valid = (value & ~LIS3DH_CTRL_REG4_FS_MASK) == 0 && !capture;
+            break;
+
+        case ACQ_CONFIG_BATCH:
+            valid = value >= 1 && value <= ACQ_DRAIN_SAMPLES;
+            break;
+
+        case ACQ_CONFIG_FORMAT:
+            valid = value <= ACQ_FORMAT_RAW8;
+            break;
+
+        case ACQ_CONFIG_STREAM:
+            valid = value <= 1;
+            break;
+
+        case ACQ_CONFIG_FILTER:
+            // The presets are designed for their own data rate, that is another one in low power mode
+            valid = value < ACQ_FILTER_PRESETS && !capture &&
+                    (!(adaptive || low_power) || presets[value].odr == LIS3DH_ODR_POWER_DOWN);
+            break;
+
+        case ACQ_CONFIG_WINDOW:
+            valid = value >= 1;
+            break;
+
+        case ACQ_CONFIG_ACTIVITY:
+            // The interrupt generator is the trigger of the capture
+            valid = value <= LIS3DH_INT1_THS_MASK && (value == 0 || !adaptive) && !capture;
+            break;
+
+        case ACQ_CONFIG_CAPTURE:
+            // A running capture has saved the configuration to restore, it must be stopped first
+            valid = value <= LIS3DH_INT1_THS_MASK && (value == 0 || (!adaptive && !capture));
+            break;
+
+        case ACQ_CONFIG_ADAPTIVE:
+            // Only one of them can own the data rate
+            valid = value == 0 ||
+                    (!activity && !capture && (sensor_count == 0 || filters[0].decimation == 1));
+            break;
+
+        case ACQ_CONFIG_CALIBRATE:
+            // The FIFOs must be in stream mode, a capture uses them differently
+            valid = !capture && (value < CALIBRATION_POSITIONS || value == CALIBRATION_CLEAR ||
+                                 (value == CALIBRATION_SAVE && Calibration_IsComplete()));
+            break;
+
+        case ACQ_CONFIG_LOW_POWER:
+            // 1.6 kHz only exists in low power mode, 1.344 kHz becomes 5.376 kHz under the filter presets
+            valid = value <= 1 && !capture &&
+                    (value || active_odr != LIS3DH_ODR_1600HZ_LP) &&
+                    (!value || sensor_count == 0 || filters[0].decimation == 1);
+            break;
+
+        case ACQ_CONFIG_CLOCK:
+            // The I2C and UART rates must stay the same
+            valid = Clock_Check(value) == NO_ERROR;
+            break;
+
+        case ACQ_CONFIG_IMPACT:
+            // A threshold above the full scale range could never be reached
+            valid = sensor_count == 0 ||
+                    (uint32_t)value * ACQ_IMPACT_UNIT_MG < (uint32_t)LIS3DH_GetSensitivity(&sensors[0]) * 2048;
+            break;
+
+        default:
+            valid = 0;
+            break;
+    }
+
+    if (!valid || config_item || (sensor_count == 0 && Acquisition_UsesSensors(item)))
+    {
+        return ERROR;
+    }
+
+    config_item = item;
+    config_value = value;
+
+    // Without sensors the end of a round never comes
+    if (sensor_count == 0)
+    {
+        Acquisition_ApplyConfig();
+    }
+
+    return NO_ERROR;
+}
+
+RAM_CODE uint8_t Acquisition_Task(void)
+{
+    ErrorCode result;
+    uint8_t busy = 0;
+
+    if (sensor_count > 0 && !I2C_Peripheral_Poll(&result)) // The bus is free: the transfer in progress, if any, is completed
+    {
+        switch (phase)
+        {
+            case ACQ_PHASE_STATUS:
+                busy = 1;
+                pending = 0;
+                if (result == NO_ERROR)
+                {
+                    Acquisition_CheckOverrun();
+                    pending = LIS3DH_GetFifoLevel(&sensors[current]);
+                }
+                remaining[current] = pending;
+                // Under backpressure fewer and longer reads leave more time to the UART
+                if (pending > ((flow == ACQ_FLOW_NORMAL) ? batch : ACQ_DRAIN_SAMPLES))
+                {
+                    pending = (flow == ACQ_FLOW_NORMAL) ? batch : ACQ_DRAIN_SAMPLES;
+                }
+                remaining[current] -= pending;
+
+                if (pending > 0)
+                {
+                    if (buffers[fill].samples)  // The buffer must be encoded before being filled again
+                    {
+                        Acquisition_Encode(&buffers[fill]);
+                    }
+                    buffers[fill].dev = &sensors[current];
+                    LIS3DH_StartReadFifoData(&sensors[current], buffers[fill].data, pending);
+                    phase = ACQ_PHASE_DATA;
+                }
+                else
+                {
+                    Acquisition_NextSensor();
+                }
+                break;
+
+            case ACQ_PHASE_DATA:
+                busy = 1;
+                if (result == NO_ERROR)
+                {
+                    acquired += pending;
+                    buffers[fill].samples = pending;
+                    fill ^= 1;  // Swap: the new samples are encoded while the next transfer fills the other buffer
+
+                    if (remaining[current] > 0)
+                    {
+                        backlog = 1;    // The drain was capped, the slow channels would delay the rest
+                    }
+                    if (current == 0)
+                    {
+                        aux_samples += pending; // The accelerometer samples are the time base of the slow channels
+                    }
+                }
+                else
+                {
+                    // The samples already clocked out of the FIFO are gone
+                    lost_i2c += pending;
+                    Acquisition_SendGap(&sensors[current], STREAM_GAP_I2C, pending);
+                }
+                Acquisition_NextSensor();
+
+                // The next sensor is read while the buffer just filled is encoded below
+                Acquisition_StartDrain();
+                break;
+
+            default:
+                if (Acquisition_StartDrain())
+                {
+                    busy = 1;
+                    break;
+                }
+
+                // Paused, idle or capturing: the FIFOs are not drained, nothing to wait for
+                if (capture)
+                {
+                    Capture_Task();
+                }
+                else if (streaming)
+                {
+                    Acquisition_PollActivity();
+                }
+                if (config_item)
+                {
+                    Acquisition_ApplyConfig();
+                }
+                break;
+        }
+    }
+
+    // While the samples are read, the other buffer is encoded and sent. Not during the
+    //      short status read: the data transfer that follows would wait for the encoding
+    if (buffers[fill ^ 1].samples && phase != ACQ_PHASE_STATUS)
+    {
+        Acquisition_Encode(&buffers[fill ^ 1]);
+        busy = 1;
+    }
+    Stream_Pump();
+
+    return busy;
+}
+
+void Acquisition_GetStats(Acquisition_Stats* stats)
+{
+    stats->acquired = acquired;
+    stats->sent = sent;
+    stats->lost_overrun = lost_overrun;
+    stats->lost_i2c = lost_i2c;
+    stats->shed = shed;
+    stats->encode_cycles = encode_cycles;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,238 @@
+/**
+*   \file Acquisition.h
+*   \brief Double buffered acquisition pipeline.
+*
+*   Two buffers are used in ping-pong: while the I2C interface drains the
+*   FIFO of a sensor into one buffer without blocking, the samples of the
+*   other buffer are encoded and moved to the UART. Bus and serial link
+*   work at the same time instead of one after the other.
+*
+*   With ACQ_CONFIG_ACTIVITY the streaming is gated by the activity
+*   detection of the sensors: without movement for ACQ_QUIET_US the sensors
+*   slow down to ACQ_IDLE_ODR and nothing is sent. When activity is
+*   detected, the samples collected by the FIFOs before the event are sent
+*   first, then the full data rate is restored. Every transition is
+*   signalled by a STREAM_TYPE_EVENT frame.
+*
+*   With ACQ_CONFIG_ADAPTIVE the data rate follows the motion energy of the
+*   sensors, measured every ACQ_MOTION_WINDOW_US: above the threshold the
+*   sensors move to ACQ_MOTION_HIGH_ODR, or stay at the rate of
+*   ACQ_CONFIG_ODR when it's faster, below a quarter of it they move
+*   back to ACQ_IDLE_ODR, in between they run at the rate of ACQ_CONFIG_ODR.
+*   The rate goes up at once and down one level after ACQ_MOTION_HOLD_WINDOWS
+*   quiet windows. Every change is tagged by a STREAM_EVENT_RATE event. The
+*   adaptive rate excludes the activity gating, the capture and the filter
+*   presets, which fix the rate on their own. A running capture rejects a
+*   new threshold, the activity gating and the settings of CTRL_REG1 and
+*   CTRL_REG4 (data rate, full scale, filter, low power) until it's
+*   stopped with 0.
+*
+*   The output adapts to the occupancy of the UART ring instead of letting
+*   the transmission block the drains: when the ring fills up, the largest
+*   batch is used and the SI frames are replaced by the compact raw ones;
+*   if it stays almost full, only one sample out of ACQ_FLOW_SHED_RATIO is
+*   sent. The FIFOs are always drained at full rate, so nothing is lost at
+*   the sensor side, and every change of level is tagged with a
+*   STREAM_EVENT_FLOW event. The shed samples are counted in the stats.
+*
+*   With ACQ_CONFIG_IMPACT every sample read from the sensors, before the
+*   filter, is checked for impacts, whatever the output format. The end of
+*   every impact is sent as a STREAM_TYPE_IMPACT frame; the timestamp is
+*   the index of the sample since the threshold was set. For shocks above
+*   4g the full scale range must be raised first, up to LIS3DH_FS_16G.
+*
+*   With ACQ_CONFIG_LOW_POWER the sensors run in the 8 bit low power mode,
+*   the only one that reaches LIS3DH_ODR_1600HZ_LP and LIS3DH_ODR_5376HZ_LP
+*   (the code of LIS3DH_ODR_1344HZ). ACQ_FORMAT_RAW8 then packs the MSB of
+*   every axis, the whole low power sample, in 3 bytes and sends all the
+*   samples of a drain in one frame. The other formats keep working, with
+*   8 bit resolution. The FIFO is still read 6 bytes per sample, the
+*   auto-increment can't skip the LSBs: at 5.376 kHz that's about 290 kbit/s
+*   on the bus, beyond the 100 kHz of I2C_Master, and the overruns are
+*   reported with the gap frames.
+*
+*   Samples lost by an overflow of the FIFO of a sensor or by a failed read
+*   are signalled by a STREAM_TYPE_GAP frame at the position of the gap.
+*
+*   \author Simone Fiorani
+*   \date 2020
+*/
+
+#ifndef __ACQUISITION_H
+    #define __ACQUISITION_H
+
+    #include "cytypes.h"
+    #include "LIS3DH.h"
+    #include "Stream.h"
+
+    /**
+    *   \brief Maximum number of samples drained from a sensor before moving to the next one.
+    */
+    #define ACQ_DRAIN_SAMPLES 8
+
+    /**
+    *   \brief Transmitted accelerometer samples between two readings of the auxiliary ADC (100 ms at 100 Hz).
+    */
+    #define ACQ_AUX_PERIOD_SAMPLES 10
+
+    /**
+    *   \brief Settings that can be changed while the acquisition is running.
+    */
+    #define ACQ_CONFIG_ODR 0x01     ///< Output data rate of all the sensors, one of the LIS3DH_ODR_xxx values, not with a filter preset
+    #define ACQ_CONFIG_FSR 0x02     ///< Full scale range of all the sensors, one of the LIS3DH_FS_xxx values
+    #define ACQ_CONFIG_BATCH 0x03   ///< Samples drained from a sensor at a time, 1 to ACQ_DRAIN_SAMPLES
+    #define ACQ_CONFIG_FORMAT 0x04  ///< Format of the accelerometer frames, one of the ACQ_FORMAT_xxx values
+    #define ACQ_CONFIG_STREAM 0x05  ///< 1 to stream the samples, 0 to pause
+    #define ACQ_CONFIG_FILTER 0x06  ///< Low pass filter and decimation, one of the ACQ_FILTER_xxx presets
+    #define ACQ_CONFIG_WINDOW 0x07  ///< Window of the features, in units of ACQ_WINDOW_UNIT samples
+    #define ACQ_CONFIG_ACTIVITY 0x08    ///< Activity threshold in LSB of INT1_THS, 0 to stream continuously
+    #define ACQ_CONFIG_CAPTURE 0x09 ///< Trigger threshold in LSB of INT1_THS to arm the capture of transients, 0 to stream
+    #define ACQ_CONFIG_CALIBRATE 0x0A   ///< Step of the calibration, one of the CALIBRATION_xxx positions or commands
+    #define ACQ_CONFIG_IMPACT 0x0B  ///< Impact threshold in units of ACQ_IMPACT_UNIT_MG, below the full scale range, 0 to disable
+    #define ACQ_CONFIG_ADAPTIVE 0x0C    ///< Motion threshold of the adaptive data rate in units of ACQ_MOTION_UNIT_MG, 0 to disable
+    #define ACQ_CONFIG_CLOCK 0x0D   ///< Bus clock, one of the CLOCK_PROFILE_xxx values
+    #define ACQ_CONFIG_LOW_POWER 0x0E   ///< 1 for the 8 bit low power mode, 0 for the 12 bit high resolution mode
+
+    #define ACQ_FORMAT_SI 0     ///< STREAM_TYPE_ACC frames in mm/s^2
+    #define ACQ_FORMAT_RAW 1    ///< STREAM_TYPE_RAW frames in digits
+    #define ACQ_FORMAT_SPECTRUM 2   ///< STREAM_TYPE_SPECTRUM frames, one per axis every SPECTRUM_SIZE samples
+    #define ACQ_FORMAT_FEATURES 3   ///< STREAM_TYPE_FEATURES frames, one every window
+    #define ACQ_FORMAT_TILT 4       ///< STREAM_TYPE_TILT frames with pitch and roll of every sample
+    #define ACQ_FORMAT_RAW8 5       ///< STREAM_TYPE_RAW8 frames with the 8 bit samples of a drain
+
+    /**
+    *   \brief Samples in a unit of the window of the features.
+    */
+    #define ACQ_WINDOW_UNIT 16
+
+    /**
+    *   \brief Default window of the features, in units (1.28 s at 100 Hz).
+    */
+    #define ACQ_WINDOW_DEFAULT 8
+
+    #define ACQ_FILTER_NONE 0       ///< All the samples at the data rate of the sensor
+    #define ACQ_FILTER_LP50_D8 1    ///< 1.344 kHz, 4th order Butterworth at 50 Hz, 168 Hz output
+    #define ACQ_FILTER_LP30_D12 2   ///< 1.344 kHz, 4th order Butterworth at 30 Hz, 112 Hz output
+    #define ACQ_FILTER_PRESETS 3    ///< Number of filter presets
+
+    /**
+    *   \brief Sections of the presets, Butterworth cascades designed with the bilinear transform at 1344 Hz.
+    *
+    *   Initializers of Filter_Biquad arrays. b1 absorbs the rounding of the
+    *   other coefficients, so the DC gain is exactly 1.
+    */
+    #define ACQ_FILTER_LP50_SECTIONS { { 184, 366, 184, -26258, 10608 }, { 205, 409, 205, -29281, 13716 } }
+    #define ACQ_FILTER_LP30_SECTIONS { { 71, 143, 71, -28735, 12636 }, { 76, 153, 76, -30799, 14720 } }
+
+    /**
+    *   \brief Unit of the impact threshold, in mg.
+    */
+    #define ACQ_IMPACT_UNIT_MG 100
+
+    /**
+    *   \brief Unit of the motion threshold of the adaptive data rate, in mg RMS.
+    */
+    #define ACQ_MOTION_UNIT_MG 10
+
+    /**
+    *   \brief Window of the motion energy of the adaptive data rate, in us.
+    */
+    #define ACQ_MOTION_WINDOW_US 250000
+
+    /**
+    *   \brief Quiet windows before the adaptive data rate drops by one level (2 s).
+    */
+    #define ACQ_MOTION_HOLD_WINDOWS 8
+
+    /**
+    *   \brief Data rate of the sensors during strong motion.
+    */
+    #define ACQ_MOTION_HIGH_ODR LIS3DH_ODR_400HZ
+
+    /**
+    *   \brief Levels of the flow control, sent with STREAM_EVENT_FLOW.
+    */
+    #define ACQ_FLOW_NORMAL 0   ///< Configured batch and format
+    #define ACQ_FLOW_COMPACT 1  ///< Largest batch, ACQ_FORMAT_SI sent as ACQ_FORMAT_RAW
+    #define ACQ_FLOW_SHED 2     ///< As compact, and only one sample out of ACQ_FLOW_SHED_RATIO is sent
+
+    #define ACQ_FLOW_COMPACT_BYTES (STREAM_TX_BUFFER_SIZE / 2)      ///< Bytes waiting in the ring that make the output compact
+    #define ACQ_FLOW_SHED_BYTES (3 * STREAM_TX_BUFFER_SIZE / 4)     ///< Bytes waiting in the ring that, if sustained, shed samples
+    #define ACQ_FLOW_RELEASE_BYTES (STREAM_TX_BUFFER_SIZE / 4)      ///< Bytes waiting in the ring below which the flow recovers
+    #define ACQ_FLOW_SHED_BUFFERS 4         ///< Consecutive buffers above ACQ_FLOW_SHED_BYTES before shedding
+    #define ACQ_FLOW_RELEASE_BUFFERS 16     ///< Consecutive buffers below ACQ_FLOW_RELEASE_BYTES to go back by one level
+    #define ACQ_FLOW_SHED_RATIO 2           ///< Decimation of the output while shedding
+
+    /**
+    *   \brief Data rate of the sensors while waiting for activity.
+    */
+    #define ACQ_IDLE_ODR LIS3DH_ODR_10HZ
+
+    /**
+    *   \brief Samples above the threshold that make an activity event.
+    */
+    #define ACQ_ACTIVITY_DURATION 1
+
+    /**
+    *   \brief Time without activity after which the streaming stops, in us.
+    */
+    #define ACQ_QUIET_US 2000000
+
+    /**
+    *   \brief Period of the poll of the activity events in idle, in us.
+    */
+    #define ACQ_IDLE_POLL_US 20000
+
+    /**
+    *   \brief Counters of the acquisition pipeline.
+    */
+    typedef struct {
+        uint32_t acquired;      ///< Samples read from the FIFOs
+        uint32_t sent;          ///< Samples given to the output format, after the decimation
+        uint32_t lost_overrun;  ///< Samples lost by the FIFOs of the sensors (estimated)
+        uint32_t lost_i2c;      ///< Samples lost by failed reads
+        uint32_t shed;          ///< Samples not sent by the flow control
+        uint32_t encode_cycles; ///< Cycles spent encoding the samples read, from filter to framing, without the waits for the UART
+    } Acquisition_Stats;
+
+    /**
+    *   \brief Start the acquisition from the configured sensors.
+    *
+    *   \param sensors Array of configured devices, in FIFO stream mode.
+    *   \param sensor_count Number of devices in the array.
+    */
+    void Acquisition_Start(LIS3DH_Handle* sensors, uint8_t sensor_count);
+
+    /**
+    *   \brief Carry on the acquisition pipeline.
+    *
+    *   This function never waits for the bus and must be called continuously
+    *   from the main loop.
+    *   \return 1 if some work has been done, 0 if it only waited for the bus.
+    */
+    uint8_t Acquisition_Task(void);
+
+    /**
+    *   \brief Get the counters of the acquisition pipeline.
+    *
+    *   \param stats Copy of the counters since the start.
+    */
+    void Acquisition_GetStats(Acquisition_Stats* stats);
+
+    /**
+    *   \brief Change a setting of the running acquisition.
+    *
+    *   The new value is checked and applied at the end of the current round,
+    *   when no transfer is in progress, so the stream is only paused for
+    *   the time needed to write the registers. Without sensors there are no
+    *   rounds: the settings of the sensors are rejected, the others
+    *   (batch, format, window, stream and clock) are applied at once.
+    *   \param item One of the ACQ_CONFIG_xxx settings.
+    *   \param value New value of the setting.
+    *   \retval NO_ERROR if the value is valid and has been scheduled.
+    *   \retval ERROR if the value is not valid, another change is waiting or there is no sensor to apply it to.
+    */
+    ErrorCode Acquisition_Configure(uint8_t item, uint8_t value);
+
+#endif
+/* [] END OF FILE */
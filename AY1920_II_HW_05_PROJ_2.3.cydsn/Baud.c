@@ -0,0 +1,118 @@
+/*
+* This file includes the source code of the baud rate
+* profiles of the UART.
+*/
+
+#include "Baud.h"
+#include "Stream.h"
+#include "CyLib.h"
+#include "UART_Debug.h"
+#include "UART_Debug_IntClock.h"
+
+/**
+*   \brief Bits of a character: start, 8 data bits and stop.
+*/
+#define BAUD_BITS_PER_CHAR 10
+
+static const uint32_t rates[BAUD_PROFILES] = { 19200, 115200, 230400, 460800, 921600, 500000, 1000000 };
+
+static uint8_t profile_in_use = BAUD_PROFILE_19200;
+
+/**
+*   \brief Cycles of the bus clock in a character at the profile in use.
+*/
+static uint32_t Baud_CharCycles(void)
+{
+    return (BAUD_CLOCK_HZ / rates[profile_in_use]) * BAUD_BITS_PER_CHAR;
+}
+
+void Baud_Start(void)
+{
+    Stream_StartRx(Baud_CharCycles());
+}
+
+ErrorCode Baud_Compute(uint32_t clock_hz, uint32_t baud, uint16_t* divider, int16_t* error_permille)
+{
+    uint32_t sample_rate = baud * UART_Debug_OVER_SAMPLE_COUNT;
+    uint32_t div = (clock_hz + sample_rate / 2) / sample_rate;  // Nearest divider
+
+    if (div == 0 || div > 0xFFFF)
+    {
+        return ERROR;
+    }
+
+    int32_t real = clock_hz / (div * UART_Debug_OVER_SAMPLE_COUNT);
+
+    *divider = div;
+    *error_permille = (int16_t)(((real - (int32_t)baud) * 1000) / (int32_t)baud);
+
+    if (*error_permille > BAUD_MAX_ERROR_PERMILLE || *error_permille < -BAUD_MAX_ERROR_PERMILLE)
+    {
+        return ERROR;
+    }
+
+    return NO_ERROR;
+}
+
+ErrorCode Baud_Check(uint8_t profile)
+{
+    uint16_t divider;
+    int16_t error_permille;
+
+    if (profile >= BAUD_PROFILES)
+    {
+        return ERROR;
+    }
+
+    return Baud_Compute(BAUD_CLOCK_HZ, rates[profile], &divider, &error_permille);
+}
+
+ErrorCode Baud_SetProfile(uint8_t profile)
+{
+    uint16_t divider;
+    int16_t error_permille;
+
+    if (profile >= BAUD_PROFILES ||
+        Baud_Compute(BAUD_CLOCK_HZ, rates[profile], &divider, &error_permille) != NO_ERROR)
+    {
+        return ERROR;
+    }
+
+    Baud_Drain();
+
+    UART_Debug_IntClock_SetDividerRegister(divider - 1, 1);
+    profile_in_use = profile;
+    Stream_RetuneRx(Baud_CharCycles());     // Bytes received across the switch are garbage
+
+    return NO_ERROR;
+}
+
+void Baud_Drain(void)
+{
+    // The last byte leaves the FIFO one character before the end of its stop bit
+    Stream_Flush();
+    CyDelayUs((BAUD_BITS_PER_CHAR * 1000000u) / rates[profile_in_use] + 1);
+}
+
+void Baud_Retune(void)
+{
+    uint16_t divider;
+    int16_t error_permille;
+
+    Baud_Compute(BAUD_CLOCK_HZ, rates[profile_in_use], &divider, &error_permille);
+
+    UART_Debug_IntClock_SetDividerRegister(divider - 1, 1);
+    Stream_RetuneRx(Baud_CharCycles());
+}
+
+uint8_t Baud_GetProfile(void)
+{
+    return profile_in_use;
+}
+
+uint32_t Baud_GetRate(void)
+{
+    return rates[profile_in_use];
+}
+
+/* [] END OF FILE */
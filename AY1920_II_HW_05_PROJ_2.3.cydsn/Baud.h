@@ -0,0 +1,104 @@
+/**
+*   \file Baud.h
+*   \brief Baud rate profiles of the UART.
+*
+*   The clock of UART_Debug is divided from the bus clock and oversampled
+*   8 times, so only the rates that are close enough to an integer divider
+*   can be used. Every profile is checked before being applied and rejected
+*   if the error is above BAUD_MAX_ERROR_PERMILLE: at 24 MHz 460800 and
+*   921600 baud are out of tolerance, 500000 and 1000000 are exact. At
+*   48 MHz 460800 is within tolerance, at 64 MHz it's out again (see
+*   Clock.h).
+*
+*   \author Simone Fiorani
+*   \date 2020
+*/
+
+#ifndef __BAUD_H
+    #define __BAUD_H
+
+    #include "cytypes.h"
+    #include "Clock.h"
+    #include "ErrorCodes.h"
+
+    /**
+    *   \brief Frequency of the source of the UART clock.
+    */
+    #define BAUD_CLOCK_HZ Clock_GetHz()
+
+    /**
+    *   \brief Largest accepted error between the nominal and the real rate, in thousandths.
+    */
+    #define BAUD_MAX_ERROR_PERMILLE 20
+
+    #define BAUD_PROFILE_19200 0    ///< Rate of the design, selected at startup
+    #define BAUD_PROFILE_115200 1   ///< 115200 baud
+    #define BAUD_PROFILE_230400 2   ///< 230400 baud
+    #define BAUD_PROFILE_460800 3   ///< 460800 baud
+    #define BAUD_PROFILE_921600 4   ///< 921600 baud
+    #define BAUD_PROFILE_500000 5   ///< 500000 baud
+    #define BAUD_PROFILE_1000000 6  ///< 1000000 baud
+
+    /**
+    *   \brief Number of baud rate profiles.
+    */
+    #define BAUD_PROFILES 7
+
+    /**
+    *   \brief Compute the divider of the UART clock for a baud rate.
+    *
+    *   \param clock_hz Frequency of the source of the UART clock.
+    *   \param baud Nominal baud rate.
+    *   \param divider Divider of the source clock.
+    *   \param error_permille Error of the real rate, in thousandths.
+    *   \retval NO_ERROR if the error is within BAUD_MAX_ERROR_PERMILLE.
+    *   \retval ERROR if the rate can't be generated.
+    */
+    ErrorCode Baud_Compute(uint32_t clock_hz, uint32_t baud, uint16_t* divider, int16_t* error_permille);
+
+    /**
+    *   \brief Start the reception of the UART at the profile of the design.
+    *
+    *   Called once, after UART_Debug_Start().
+    */
+    void Baud_Start(void);
+
+    /**
+    *   \brief Check that a profile can be generated from the current clock.
+    *
+    *   \param profile One of the BAUD_PROFILE_xxx values.
+    */
+    ErrorCode Baud_Check(uint8_t profile);
+
+    /**
+    *   \brief Switch the UART to a profile.
+    *
+    *   The bytes already queued are sent at the old rate before switching.
+    *   \param profile One of the BAUD_PROFILE_xxx values.
+    */
+    ErrorCode Baud_SetProfile(uint8_t profile);
+
+    /**
+    *   \brief Send the bytes queued and wait until the last one has left the line.
+    */
+    void Baud_Drain(void);
+
+    /**
+    *   \brief Generate the profile in use again after a change of the bus clock.
+    *
+    *   The new clock must have been checked with Baud_Compute().
+    */
+    void Baud_Retune(void);
+
+    /**
+    *   \brief Profile currently in use.
+    */
+    uint8_t Baud_GetProfile(void);
+
+    /**
+    *   \brief Nominal baud rate currently in use.
+    */
+    uint32_t Baud_GetRate(void);
+
+#endif
+/* [] END OF FILE */
@@ -0,0 +1,293 @@
+/*
+* This file includes the source code of the calibration
+* of the axes and of its storage in flash.
+*/
+
+#include "Calibration.h"
+#include "RamCode.h"
+#include "Timing.h"
+#include "cy_em_eeprom.h"
+
+/**
+*   \brief Marks a valid record in flash.
+*/
+#define CALIBRATION_MAGIC 0x43414C31u
+
+/**
+*   \brief Fractional bits of the averaged readings.
+*/
+#define CALIBRATION_MEAN_SHIFT 4
+
+/**
+*   \brief Gravity acceleration in mm/s^2, the output of 1 mg.
+*/
+#define CALIBRATION_G_MM 9806
+
+/**
+*   \brief Samples read from the FIFO at a time.
+*/
+#define CALIBRATION_CHUNK 8
+
+/**
+*   \brief Record stored in flash.
+*/
+typedef struct {
+    uint32_t magic;                             // CALIBRATION_MAGIC
+    int16_t offset[LIS3DH_MAX_DEVICES][3];      // mg with CALIBRATION_MEAN_SHIFT fractional bits
+    uint16_t gain[LIS3DH_MAX_DEVICES][3];       // CALIBRATION_GAIN_SHIFT fractional bits
+} CalibrationRecord;
+
+// Storage of the emulated EEPROM, aligned to the rows of the flash
+CY_ALIGN(CY_EM_EEPROM_FLASH_SIZEOF_ROW)
+static const uint8_t storage[CY_EM_EEPROM_GET_PHYSICAL_SIZE(sizeof(CalibrationRecord), 1u, 0u)] = {0u};
+
+static cy_stc_eeprom_context_t context;
+static CalibrationRecord record;                // Coefficients in use
+static uint8_t stored;                          // Set if the coefficients in use are stored in flash
+
+static int32_t readings[LIS3DH_MAX_DEVICES][CALIBRATION_POSITIONS];    // Mean of the axis to the ground, same unit of the offset
+static uint8_t measured;                        // Positions measured, one bit each
+static uint8_t measured_count;                  // Sensors measured
+
+static Calibration_Axis conversion[LIS3DH_MAX_DEVICES][3];  // Coefficients for the cached sensitivity
+static uint8_t cached[LIS3DH_MAX_DEVICES];      // Sensitivity of the coefficients, 0 if they must be computed
+
+/**
+*   \brief Division rounded to the nearest integer.
+*/
+static int32_t Calibration_Divide(int64_t value, int32_t divisor)
+{
+    return (value >= 0) ? (value + divisor / 2) / divisor : (value - divisor / 2) / divisor;
+}
+
+/**
+*   \brief Use the nominal sensitivity for all the sensors.
+*/
+static void Calibration_Identity(void)
+{
+    record.magic = CALIBRATION_MAGIC;
+
+    for (uint8_t s = 0; s < LIS3DH_MAX_DEVICES; s++)
+    {
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            record.offset[s][axis] = 0;
+            record.gain[s][axis] = 1 << CALIBRATION_GAIN_SHIFT;
+        }
+    }
+}
+
+/**
+*   \brief Write the record in flash and use it from now on.
+*/
+static ErrorCode Calibration_Store(void)
+{
+    for (uint8_t s = 0; s < LIS3DH_MAX_DEVICES; s++)
+    {
+        cached[s] = 0;
+    }
+
+    stored = (Cy_Em_EEPROM_Write(0, &record, sizeof(record), &context) == CY_EM_EEPROM_SUCCESS);
+
+    return stored ? NO_ERROR : ERROR;
+}
+
+void Calibration_Start(void)
+{
+    cy_stc_eeprom_config_t config = {
+        .eepromSize = sizeof(CalibrationRecord),
+        .wearLevelingFactor = 1u,
+        .redundantCopy = 0u,
+        .blockingWrite = 1u,
+        .userFlashStartAddr = (uint32)storage,
+    };
+
+    stored = Cy_Em_EEPROM_Init(&config, &context) == CY_EM_EEPROM_SUCCESS &&
+             Cy_Em_EEPROM_Read(0, &record, sizeof(record), &context) == CY_EM_EEPROM_SUCCESS &&
+             record.magic == CALIBRATION_MAGIC;
+
+    if (!stored)
+    {
+        Calibration_Identity();     // Never calibrated, or the flash is corrupted
+    }
+
+    for (uint8_t s = 0; s < LIS3DH_MAX_DEVICES; s++)
+    {
+        cached[s] = 0;
+    }
+    measured = 0;
+}
+
+const Calibration_Axis* Calibration_Get(uint8_t channel, uint8_t sensitivity)
+{
+    if (channel >= LIS3DH_MAX_DEVICES)
+    {
+        return NULL;
+    }
+
+    if (cached[channel] != sensitivity)
+    {
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            int64_t gain = record.gain[channel][axis];
+
+            // digits * sensitivity is in mg, corrected as (mg - offset) * gain and then
+            //      converted to mm/s^2, all folded in a scale and a bias
+            conversion[channel][axis].scale =
+                Calibration_Divide(sensitivity * gain * CALIBRATION_G_MM * (1 << CALIBRATION_SHIFT),
+                                   1000 << CALIBRATION_GAIN_SHIFT);
+            conversion[channel][axis].bias =
+                (1 << (CALIBRATION_SHIFT - 1)) -
+                Calibration_Divide(record.offset[channel][axis] * gain * CALIBRATION_G_MM * (1 << CALIBRATION_SHIFT),
+                                   1000 << (CALIBRATION_GAIN_SHIFT + CALIBRATION_MEAN_SHIFT));
+        }
+        cached[channel] = sensitivity;
+    }
+
+    return conversion[channel];
+}
+
+RAM_CODE void Calibration_Convert(const Calibration_Axis* axes, const uint8_t* AccData, int32_t* acc)
+{
+    for (uint8_t axis = 0; axis < 3; axis++)
+    {
+        int16_t digits = (int16)(AccData[2*axis] | (AccData[2*axis+1]<<8)) >> 4;   // Right aligned 12 bit value
+
+        acc[axis] = (digits * axes[axis].scale + axes[axis].bias) >> CALIBRATION_SHIFT;
+    }
+}
+
+ErrorCode Calibration_Measure(LIS3DH_Handle* sensors, uint8_t sensor_count, uint8_t position)
+{
+    uint8_t data[CALIBRATION_CHUNK * LIS3DH_SAMPLE_SIZE];
+    uint8_t collected[LIS3DH_MAX_DEVICES];
+    int32_t sum[LIS3DH_MAX_DEVICES];
+    uint8_t axis = position / 2;
+    uint8_t done = 0;
+    uint8_t count;
+
+    for (uint8_t s = 0; s < sensor_count; s++)
+    {
+        // Samples taken while the sensor was being moved are discarded
+        do
+        {
+            LIS3DH_ReadFifo(&sensors[s], data, CALIBRATION_CHUNK, &count);
+        } while (count == CALIBRATION_CHUNK);
+
+        collected[s] = 0;
+        sum[s] = 0;
+    }
+
+    uint32_t start = Timing_Now();
+
+    while (done < sensor_count && Timing_Elapsed(start) < TIMING_US_TO_CYCLES(CALIBRATION_TIMEOUT_US))
+    {
+        for (uint8_t s = 0; s < sensor_count; s++)
+        {
+            uint8_t missing = CALIBRATION_SAMPLES - collected[s];
+
+            if (missing == 0)
+            {
+                continue;
+            }
+
+            LIS3DH_ReadFifo(&sensors[s], data, (missing > CALIBRATION_CHUNK) ? CALIBRATION_CHUNK : missing, &count);
+
+            for (uint8_t i = 0; i < count; i++)
+            {
+                const uint8_t* sample = &data[i * LIS3DH_SAMPLE_SIZE + 2 * axis];
+
+                sum[s] += ((int16)(sample[0] | (sample[1]<<8)) >> 4) * LIS3DH_GetSensitivity(&sensors[s]);
+            }
+
+            collected[s] += count;
+            if (collected[s] == CALIBRATION_SAMPLES)
+            {
+                done++;
+            }
+        }
+    }
+
+    if (done < sensor_count)
+    {
+        return ERROR;
+    }
+
+    for (uint8_t s = 0; s < sensor_count; s++)
+    {
+        readings[s][position] = Calibration_Divide((int64_t)sum[s] * (1 << CALIBRATION_MEAN_SHIFT), CALIBRATION_SAMPLES);
+    }
+
+    // The positions of a calibration must come from the same sensors
+    if (sensor_count != measured_count)
+    {
+        measured = 0;
+        measured_count = sensor_count;
+    }
+    measured |= 1 << position;
+
+    return NO_ERROR;
+}
+
+uint8_t Calibration_IsComplete(void)
+{
+    return measured == (1 << CALIBRATION_POSITIONS) - 1;
+}
+
+ErrorCode Calibration_Save(void)
+{
+    CalibrationRecord computed = record;   // The sensors not measured keep their coefficients
+
+    if (!Calibration_IsComplete())
+    {
+        return ERROR;
+    }
+
+    for (uint8_t s = 0; s < measured_count; s++)
+    {
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            int32_t up = readings[s][2 * axis];
+            int32_t down = readings[s][2 * axis + 1];
+            int32_t offset = Calibration_Divide(up + down, 2);
+
+            if (up <= down)
+            {
+                return ERROR;   // Positions swapped
+            }
+
+            // (up - down) / 2 must become 1000 mg
+            int32_t gain = Calibration_Divide((int64_t)(2000 << CALIBRATION_MEAN_SHIFT) << CALIBRATION_GAIN_SHIFT,
+                                              up - down);
+
+            if (gain < CALIBRATION_GAIN_MIN || gain > CALIBRATION_GAIN_MAX ||
+                offset < INT16_MIN || offset > INT16_MAX)
+            {
+                return ERROR;   // Not a still sensor in the right position
+            }
+
+            computed.offset[s][axis] = offset;
+            computed.gain[s][axis] = gain;
+        }
+    }
+
+    record = computed;
+    measured = 0;
+
+    return Calibration_Store();
+}
+
+ErrorCode Calibration_Clear(void)
+{
+    Calibration_Identity();
+    measured = 0;
+
+    return Calibration_Store();
+}
+
+uint8_t Calibration_GetStatus(void)
+{
+    return measured | (stored ? CALIBRATION_STORED : 0);
+}
+
+/* [] END OF FILE */
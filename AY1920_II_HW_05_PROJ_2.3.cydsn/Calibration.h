@@ -0,0 +1,136 @@
+/**
+*   \file Calibration.h
+*   \brief Offset and gain of the axes of the sensors, stored in flash.
+*
+*   The calibration uses the 6-position method: the sensor is held still
+*   with each axis pointing up and then down, so that the axis reads +1g
+*   and -1g. For every axis the offset is the mean of the two readings and
+*   the gain brings their half difference to exactly 1g. The readings are
+*   averaged over CALIBRATION_SAMPLES samples, in mg, so the result doesn't
+*   depend on the full scale range.
+*
+*   The coefficients are stored with the emulated EEPROM and loaded at
+*   boot. The conversion to mm/s^2 folds sensitivity, gain and offset in a
+*   single multiply-add per axis: out = (digits * scale + bias) >> 12.
+*
+*   \author Simone Fiorani
+*   \date 2020
+*/
+
+#ifndef __CALIBRATION_H
+    #define __CALIBRATION_H
+
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+    #include "LIS3DH.h"
+
+    #define CALIBRATION_X_UP 0      ///< X axis pointing up, it reads +1g
+    #define CALIBRATION_X_DOWN 1    ///< X axis pointing down, it reads -1g
+    #define CALIBRATION_Y_UP 2      ///< Y axis pointing up
+    #define CALIBRATION_Y_DOWN 3    ///< Y axis pointing down
+    #define CALIBRATION_Z_UP 4      ///< Z axis pointing up
+    #define CALIBRATION_Z_DOWN 5    ///< Z axis pointing down
+    #define CALIBRATION_POSITIONS 6 ///< Number of positions
+
+    #define CALIBRATION_SAVE 6      ///< Compute the coefficients from the 6 positions and store them
+    #define CALIBRATION_CLEAR 7     ///< Go back to the nominal sensitivity and store it
+
+    /**
+    *   \brief Flag of the status, set when the coefficients in use are stored in flash.
+    */
+    #define CALIBRATION_STORED 0x80
+
+    /**
+    *   \brief Samples averaged for every position.
+    */
+    #define CALIBRATION_SAMPLES 32
+
+    /**
+    *   \brief Time allowed to collect the samples of a position, in us.
+    */
+    #define CALIBRATION_TIMEOUT_US 5000000
+
+    /**
+    *   \brief Fractional bits of the gain.
+    */
+    #define CALIBRATION_GAIN_SHIFT 14
+
+    /**
+    *   \brief Fractional bits of the coefficients of the conversion.
+    */
+    #define CALIBRATION_SHIFT 12
+
+    /**
+    *   \brief Accepted gain range, 0.8 to 1.25.
+    */
+    #define CALIBRATION_GAIN_MIN 13107
+    #define CALIBRATION_GAIN_MAX 20480
+
+    /**
+    *   \brief Conversion of an axis from digits to mm/s^2.
+    */
+    typedef struct {
+        int32_t scale;  ///< mm/s^2 per digit, CALIBRATION_SHIFT fractional bits
+        int32_t bias;   ///< Offset in mm/s^2 with CALIBRATION_SHIFT fractional bits, rounding included
+    } Calibration_Axis;
+
+    /**
+    *   \brief Load the stored coefficients, the nominal sensitivity is used if there are none.
+    */
+    void Calibration_Start(void);
+
+    /**
+    *   \brief Conversion of the axes of a sensor for its full scale range.
+    *
+    *   The coefficients are only computed again when the sensitivity changes.
+    *   \param channel Channel ID of the sensor.
+    *   \param sensitivity Sensitivity of the sensor in mg/digit.
+    *   \return Coefficients of the X, Y and Z axis, NULL if the channel doesn't exist.
+    */
+    const Calibration_Axis* Calibration_Get(uint8_t channel, uint8_t sensitivity);
+
+    /**
+    *   \brief Convert a sample to mm/s^2, one multiply-add per axis.
+    *
+    *   \param axes Coefficients returned by Calibration_Get().
+    *   \param AccData LSB and MSB of the X, Y and Z axis, as read from the sensor.
+    *   \param acc X, Y and Z acceleration in mm/s^2.
+    */
+    void Calibration_Convert(const Calibration_Axis* axes, const uint8_t* AccData, int32_t* acc);
+
+    /**
+    *   \brief Average the axis that points to the ground in a position, for all the sensors.
+    *
+    *   Blocks until CALIBRATION_SAMPLES samples have been read from the FIFO
+    *   of every sensor, the sensors must be held still.
+    *   \param sensors Array of configured devices, in FIFO stream mode.
+    *   \param sensor_count Number of devices in the array.
+    *   \param position One of the CALIBRATION_xxx positions.
+    *   \retval ERROR if some sensor didn't provide the samples in time.
+    */
+    ErrorCode Calibration_Measure(LIS3DH_Handle* sensors, uint8_t sensor_count, uint8_t position);
+
+    /**
+    *   \brief Check that all the positions have been measured.
+    */
+    uint8_t Calibration_IsComplete(void);
+
+    /**
+    *   \brief Compute the coefficients from the 6 positions and store them in flash.
+    *
+    *   \retval ERROR if some gain is out of range or the write failed.
+    */
+    ErrorCode Calibration_Save(void);
+
+    /**
+    *   \brief Go back to the nominal sensitivity and store it in flash.
+    */
+    ErrorCode Calibration_Clear(void);
+
+    /**
+    *   \brief Positions measured so far, one bit each, plus CALIBRATION_STORED.
+    */
+    uint8_t Calibration_GetStatus(void);
+
+#endif
+/* [] END OF FILE */
@@ -0,0 +1,129 @@
+/*
+* This file includes the source code of the capture of
+* transients with the Stream-to-FIFO mode.
+*/
+
+#include "Capture.h"
+#include "Stream.h"
+#include "Timing.h"
+#include "CyLib.h"
+
+static LIS3DH_Handle* sensors;
+static uint8_t sensor_count;
+static uint8_t armed;                               // Set while the capture is armed
+static uint8_t software_trigger;                    // Set by Capture_Trigger()
+static uint32_t last_poll;                          // Cycle counter at the last poll of the events
+
+static uint8_t saved_ctrl1[LIS3DH_MAX_DEVICES];     // CTRL_REG1 of the streaming configuration
+static uint8_t saved_ctrl4[LIS3DH_MAX_DEVICES];     // CTRL_REG4 of the streaming configuration
+
+static uint8_t burst[2 * LIS3DH_FIFO_SIZE * LIS3DH_SAMPLE_SIZE];   // Pre-trigger and post-trigger samples
+
+/**
+*   \brief Drain the history and the post-trigger window of a sensor and send the burst.
+*/
+static void Capture_Burst(LIS3DH_Handle* dev)
+{
+    uint8_t pre;
+    uint8_t post;
+    uint32_t detected = Timing_Now();
+
+    // The FIFO is frozen by the trigger, the samples before the event are read first
+    LIS3DH_ReadFifo(dev, burst, LIS3DH_FIFO_SIZE, &pre);
+
+    LIS3DH_RestartFifo(dev, LIS3DH_FIFO_MODE_FIFO);
+    uint32_t gap = Timing_Elapsed(detected) / TIMING_CYCLES_PER_US;     // Samples lost between the two blocks
+
+    CyDelayUs(CAPTURE_POST_WAIT_US);
+    LIS3DH_ReadFifo(dev, &burst[pre * LIS3DH_SAMPLE_SIZE], LIS3DH_FIFO_SIZE, &post);
+
+    Stream_SendCapture(dev->channel, pre, post, (gap > 0xFFFF) ? 0xFFFF : gap);
+    for (uint8_t i = 0; i < pre + post; i++)
+    {
+        Stream_SendRaw(dev->channel, &burst[i * LIS3DH_SAMPLE_SIZE]);
+    }
+
+    LIS3DH_RestartFifo(dev, LIS3DH_FIFO_MODE_STREAM_TO_FIFO);
+}
+
+void Capture_Start(LIS3DH_Handle* configured_sensors, uint8_t configured_count, uint8_t threshold)
+{
+    sensors = configured_sensors;
+    sensor_count = configured_count;
+
+    for (uint8_t s = 0; s < sensor_count; s++)
+    {
+        LIS3DH_Handle* dev = &sensors[s];
+        uint8_t stale;
+
+        saved_ctrl1[s] = LIS3DH_GetRegister(dev, LIS3DH_CTRL_REG1);
+        saved_ctrl4[s] = LIS3DH_GetRegister(dev, LIS3DH_CTRL_REG4);
+
+        LIS3DH_SetDataRate(dev, LIS3DH_ODR_5376HZ_LP);
+        LIS3DH_SetLowPower(dev, 1);
+        LIS3DH_SetActivity(dev, threshold, 1);
+        LIS3DH_Commit(dev);
+
+        LIS3DH_ReadActivity(dev, &stale);   // An old latched event must not trigger the capture
+        LIS3DH_RestartFifo(dev, LIS3DH_FIFO_MODE_STREAM_TO_FIFO);
+    }
+
+    software_trigger = 0;
+    last_poll = Timing_Now();
+    armed = 1;
+}
+
+void Capture_Stop(void)
+{
+    for (uint8_t s = 0; armed && s < sensor_count; s++)
+    {
+        LIS3DH_Handle* dev = &sensors[s];
+
+        LIS3DH_SetRegister(dev, LIS3DH_CTRL_REG1, saved_ctrl1[s]);
+        LIS3DH_SetRegister(dev, LIS3DH_CTRL_REG4, saved_ctrl4[s]);
+        LIS3DH_SetActivity(dev, 0, 0);
+        LIS3DH_Commit(dev);
+        LIS3DH_RestartFifo(dev, LIS3DH_FIFO_MODE_STREAM);
+    }
+
+    armed = 0;
+}
+
+ErrorCode Capture_Trigger(void)
+{
+    if (!armed)
+    {
+        return ERROR;
+    }
+
+    software_trigger = 1;
+
+    return NO_ERROR;
+}
+
+void Capture_Task(void)
+{
+    if (!armed || (!software_trigger && Timing_Elapsed(last_poll) < TIMING_US_TO_CYCLES(CAPTURE_POLL_US)))
+    {
+        return;
+    }
+    last_poll = Timing_Now();
+
+    for (uint8_t s = 0; s < sensor_count; s++)
+    {
+        uint8_t event = software_trigger;
+
+        if (!event)
+        {
+            LIS3DH_ReadActivity(&sensors[s], &event);
+        }
+        if (event)
+        {
+            Capture_Burst(&sensors[s]);
+        }
+    }
+
+    software_trigger = 0;
+}
+
+/* [] END OF FILE */
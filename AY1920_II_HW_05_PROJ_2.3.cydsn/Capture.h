@@ -0,0 +1,68 @@
+/**
+*   \file Capture.h
+*   \brief Capture of transients with the Stream-to-FIFO mode of the LIS3DH.
+*
+*   While armed, the sensors run at 5.376 kHz in low power mode with the
+*   FIFO in Stream-to-FIFO mode, triggered by the activity detection on
+*   INT1. The event freezes the 32 samples that preceded it in the FIFO,
+*   so the transient is captured without streaming at 5 kHz.
+*
+*   When the event is seen, the frozen history is drained, then the FIFO
+*   collects a post-trigger window of 32 more samples in FIFO mode. The
+*   two blocks are sent together as a burst: a STREAM_TYPE_CAPTURE frame
+*   followed by the samples as STREAM_TYPE_RAW frames. The burst takes
+*   the link until it has been queued, then the FIFO is armed again.
+*
+*   \author Simone Fiorani
+*   \date 2020
+*/
+
+#ifndef __CAPTURE_H
+    #define __CAPTURE_H
+
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+    #include "LIS3DH.h"
+
+    /**
+    *   \brief Period of the poll of the trigger events, in us.
+    */
+    #define CAPTURE_POLL_US 1000
+
+    /**
+    *   \brief Time to fill the FIFO at 5.376 kHz (5.95 ms) plus margin, in us.
+    */
+    #define CAPTURE_POST_WAIT_US 7000
+
+    /**
+    *   \brief Arm the capture on all the sensors.
+    *
+    *   The data rate, resolution and FIFO mode of the sensors are saved and
+    *   restored by Capture_Stop().
+    *   \param sensors Array of configured devices.
+    *   \param sensor_count Number of devices in the array.
+    *   \param threshold Trigger threshold in LSB of INT1_THS.
+    */
+    void Capture_Start(LIS3DH_Handle* sensors, uint8_t sensor_count, uint8_t threshold);
+
+    /**
+    *   \brief Disarm the capture and restore the streaming configuration.
+    */
+    void Capture_Stop(void);
+
+    /**
+    *   \brief Capture the sensors now, as if the trigger event had happened.
+    *
+    *   \retval ERROR if the capture is not armed.
+    */
+    ErrorCode Capture_Trigger(void);
+
+    /**
+    *   \brief Look for trigger events and send the bursts.
+    *
+    *   Must be called continuously while the capture is armed.
+    */
+    void Capture_Task(void);
+
+#endif
+/* [] END OF FILE */
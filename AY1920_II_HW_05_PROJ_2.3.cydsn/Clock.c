@@ -0,0 +1,125 @@
+/*
+* This file includes the source code of the profiles
+* of the CPU and bus clock.
+*/
+
+#include "Clock.h"
+#include "Baud.h"
+#include "CyFlash.h"
+#include "CyLib.h"
+#include "I2C_Master.h"
+#include "Timing.h"
+
+#if BCLK__BUS_CLK__HZ != 24000000u
+    #error "CLOCK_PROFILE_24MHZ must be the clock of the design"
+#endif
+
+/**
+*   \brief Oversampling of the fixed function I2C, I2C_Master_DEFAULT_DIVIDE_FACTOR is 24 MHz / (100 kHz * 16).
+*/
+#define CLOCK_I2C_OVERSAMPLE 16
+
+/**
+*   \brief Charge pump current of the PLL in uA, as set by the design.
+*/
+#define CLOCK_PLL_CURRENT 2
+
+/**
+*   \brief Configuration of the PLL for a profile.
+*/
+typedef struct {
+    uint8_t mhz;    // Bus clock in MHz
+    uint8_t p;      // Multiplier of the PLL
+    uint8_t q;      // Divider of the 3 MHz IMO at the input of the PLL
+} ClockProfile;
+
+static const ClockProfile profiles[CLOCK_PROFILES] = {
+    { 24,  8, 1 },
+    { 48, 16, 1 },
+    { 64, 64, 3 },
+};
+
+static uint8_t profile_in_use = CLOCK_PROFILE_24MHZ;
+
+ErrorCode Clock_Check(uint8_t profile)
+{
+    uint16_t divider;
+    int16_t error_permille;
+
+    if (profile >= CLOCK_PROFILES)
+    {
+        return ERROR;
+    }
+
+    uint32_t khz = profiles[profile].mhz * 1000u;
+
+    if (khz % (I2C_Master_DATA_RATE * CLOCK_I2C_OVERSAMPLE) != 0)
+    {
+        return ERROR;   // The I2C would run at a different rate
+    }
+
+    return Baud_Compute(khz * 1000u, Baud_GetRate(), &divider, &error_permille);
+}
+
+ErrorCode Clock_SetProfile(uint8_t profile)
+{
+    if (Clock_Check(profile) != NO_ERROR)
+    {
+        return ERROR;
+    }
+
+    const ClockProfile* next = &profiles[profile];
+    uint8_t faster = next->mhz > profiles[profile_in_use].mhz;
+
+    Baud_Drain();
+    I2C_Master_Stop();
+
+    if (faster)
+    {
+        CyFlash_SetWaitCycles(next->mhz);
+    }
+
+    (void)Timing_NowUs();   // The microseconds so far are counted at the old clock
+
+    // The PLL can only be changed while it doesn't clock the CPU
+    CyMasterClk_SetSource(CY_MASTER_SOURCE_IMO);
+    CyPLL_OUT_Stop();
+    CyPLL_OUT_SetPQ(next->p, next->q, CLOCK_PLL_CURRENT);
+    CyPLL_OUT_Start(1);
+    CyMasterClk_SetSource(CY_MASTER_SOURCE_PLL);
+
+    if (!faster)
+    {
+        CyFlash_SetWaitCycles(next->mhz);
+    }
+    profile_in_use = profile;
+    CyDelayFreq(Clock_GetHz());
+    Timing_Rebase();
+
+    // The component was initialized with the divider of the design, Start() doesn't change it
+    uint16_t i2c_divider = (next->mhz * 1000u) / (I2C_Master_DATA_RATE * CLOCK_I2C_OVERSAMPLE);
+    I2C_Master_CLKDIV1_REG = LO8(i2c_divider);
+    I2C_Master_CLKDIV2_REG = HI8(i2c_divider);
+    I2C_Master_Start();
+
+    Baud_Retune();
+
+    return NO_ERROR;
+}
+
+uint8_t Clock_GetProfile(void)
+{
+    return profile_in_use;
+}
+
+uint8_t Clock_GetMHz(void)
+{
+    return profiles[profile_in_use].mhz;
+}
+
+uint32_t Clock_GetHz(void)
+{
+    return profiles[profile_in_use].mhz * 1000000u;
+}
+
+/* [] END OF FILE */
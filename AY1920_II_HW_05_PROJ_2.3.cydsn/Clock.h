@@ -0,0 +1,73 @@
+/**
+*   \file Clock.h
+*   \brief Profiles of the CPU and bus clock.
+*
+*   The PLL multiplies the 3 MHz IMO: P/Q is 8/1 for 24 MHz, the clock of
+*   the design, 16/1 for 48 MHz and 64/3 for 64 MHz (1 MHz at the input of
+*   the PLL, the lowest it accepts). The master and bus clocks follow the
+*   PLL without division, so the dividers of the peripherals are computed
+*   again at every switch:
+*   - the fixed function I2C_Master oversamples I2C_Master_DATA_RATE 16
+*     times, its divider stays an integer in all the profiles;
+*   - UART_Debug keeps the baud rate profile in use, a clock that can't
+*     generate it within BAUD_MAX_ERROR_PERMILLE is rejected (see Baud.h).
+*
+*   The flash wait states are raised before a faster clock and lowered
+*   after a slower one. The cycle counter runs at the new clock, so
+*   TIMING_CYCLES_PER_US follows the profile and only the intervals in
+*   cycles that straddle the switch are measured in the wrong unit; the
+*   microsecond time base of Timing.h is kept continuous across it.
+*
+*   \author Simone Fiorani
+*   \date 2020
+*/
+
+#ifndef __CLOCK_H
+    #define __CLOCK_H
+
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+
+    #define CLOCK_PROFILE_24MHZ 0   ///< Clock of the design, selected at startup
+    #define CLOCK_PROFILE_48MHZ 1   ///< 48 MHz
+    #define CLOCK_PROFILE_64MHZ 2   ///< 64 MHz
+
+    /**
+    *   \brief Number of clock profiles.
+    */
+    #define CLOCK_PROFILES 3
+
+    /**
+    *   \brief Check that the peripherals keep their rates with a profile.
+    *
+    *   \param profile One of the CLOCK_PROFILE_xxx values.
+    */
+    ErrorCode Clock_Check(uint8_t profile);
+
+    /**
+    *   \brief Switch the PLL to a profile and adjust the dividers of the peripherals.
+    *
+    *   Must be called with no I2C transfer in progress, the bytes queued on
+    *   the UART are sent at the old clock before switching.
+    *   \param profile One of the CLOCK_PROFILE_xxx values.
+    *   \retval ERROR if Clock_Check() fails, nothing is changed.
+    */
+    ErrorCode Clock_SetProfile(uint8_t profile);
+
+    /**
+    *   \brief Profile currently in use.
+    */
+    uint8_t Clock_GetProfile(void);
+
+    /**
+    *   \brief Frequency of the bus clock in use, in MHz.
+    */
+    uint8_t Clock_GetMHz(void);
+
+    /**
+    *   \brief Frequency of the bus clock in use, in Hz.
+    */
+    uint32_t Clock_GetHz(void);
+
+#endif
+/* [] END OF FILE */
@@ -0,0 +1,214 @@
+/*
+* This file includes the source code of the parser of the
+* commands received through UART.
+*/
+
+#include "Command.h"
+#include "Acquisition.h"
+#include "Baud.h"
+#include "Capture.h"
+#include "Clock.h"
+#include "Stream.h"
+#include "Telemetry.h"
+#include "Timing.h"
+
+static uint8_t packet[COMMAND_PACKET_SIZE];    // Bytes of the packet being received
+static uint8_t received;                       // Bytes of the packet received so far
+static uint32_t last_byte;                     // Microsecond time base at the last byte received
+
+static uint8_t confirming;                     // Set while the new baud rate waits for the host
+static uint8_t previous_profile;               // Baud rate profile restored if the host doesn't confirm
+static uint32_t switched_at;                   // Microsecond time base at the switch of the baud rate
+
+static uint8_t benchmarking;                   // Set while the benchmark is running
+static uint32_t bench_start;                   // Microsecond time base at the beginning of the benchmark
+static uint32_t bench_duration;                // Duration of the benchmark in us
+static uint32_t bench_samples;                 // Samples acquired at the beginning of the benchmark
+static uint32_t bench_cycles;                  // Working cycles at the beginning of the benchmark
+
+/**
+*   \brief Stream the test pattern and report the achieved throughput.
+*
+*   The acquisition is paused for the duration of the test.
+*/
+static void Command_SelfTest(uint8_t units)
+{
+    uint32_t duration = TIMING_US_TO_CYCLES((uint32_t)units * COMMAND_TEST_UNIT_US);
+    uint32_t bytes = 0;
+    uint8_t sequence = 0;
+
+    Stream_Flush();     // Nothing else in the link during the measurement
+    uint32_t start = Timing_Now();
+
+    while (Timing_Elapsed(start) < duration)
+    {
+        Stream_SendPattern(sequence++);
+        bytes += STREAM_PATTERN_FRAME_SIZE;
+    }
+    Stream_Flush();
+
+    uint32_t cycles = Timing_Elapsed(start);
+
+    Stream_SendThroughput((uint32_t)(((uint64_t)bytes * Clock_GetHz()) / cycles), Baud_GetRate());
+}
+
+/**
+*   \brief Take the counters at the beginning of the benchmark.
+*/
+static void Command_StartBenchmark(uint8_t units)
+{
+    Acquisition_Stats acq;
+
+    Acquisition_GetStats(&acq);
+    bench_samples = acq.acquired;
+    bench_cycles = Telemetry_GetBusyCycles() - Stream_GetStallCycles();
+    bench_duration = (uint32_t)units * COMMAND_TEST_UNIT_US;
+    bench_start = Timing_NowUs();
+    benchmarking = 1;
+}
+
+/**
+*   \brief Report the highest sample rate once the benchmark is over.
+*/
+static void Command_CheckBenchmark(void)
+{
+    Acquisition_Stats acq;
+
+    if (!benchmarking || Timing_NowUs() - bench_start < bench_duration)
+    {
+        return;
+    }
+    benchmarking = 0;
+
+    Acquisition_GetStats(&acq);
+    uint32_t samples = acq.acquired - bench_samples;
+    uint32_t cycles = (Telemetry_GetBusyCycles() - Stream_GetStallCycles()) - bench_cycles;
+
+    Stream_SendBenchmark((cycles != 0) ? (uint32_t)(((uint64_t)samples * Clock_GetHz()) / cycles) : 0,
+                         Clock_GetHz());
+}
+
+/**
+*   \brief Execute a complete packet and send the acknowledge.
+*/
+static void Command_Execute(void)
+{
+    uint8_t opcode = packet[1];
+    uint8_t value = packet[2];
+    uint8_t result;
+
+    if ((packet[0] ^ packet[1] ^ packet[2]) != packet[3])
+    {
+        result = COMMAND_STATUS_CHECKSUM;
+    }
+    else if (opcode == COMMAND_PING)
+    {
+        result = COMMAND_STATUS_OK;
+    }
+    else if (opcode == COMMAND_SET_BAUD)
+    {
+        if (Baud_Check(value) != NO_ERROR)
+        {
+            result = COMMAND_STATUS_REJECTED;   // Out of tolerance with the current clock
+        }
+        else
+        {
+            Stream_SendStatus(opcode, COMMAND_STATUS_OK, value);    // Acknowledged at the old rate
+
+            previous_profile = Baud_GetProfile();
+            Baud_SetProfile(value);
+            confirming = 1;
+            switched_at = Timing_NowUs();
+            return;
+        }
+    }
+    else if (opcode == COMMAND_TELEMETRY)
+    {
+        Telemetry_SetPeriod(value);
+        result = COMMAND_STATUS_OK;
+    }
+    else if (opcode == COMMAND_TRIGGER)
+    {
+        result = (Capture_Trigger() == NO_ERROR) ? COMMAND_STATUS_OK : COMMAND_STATUS_REJECTED;
+    }
+    else if (opcode == COMMAND_SELF_TEST)
+    {
+        if (value == 0)
+        {
+            result = COMMAND_STATUS_REJECTED;
+        }
+        else
+        {
+            Stream_SendStatus(opcode, COMMAND_STATUS_OK, value);
+            Command_SelfTest(value);
+            return;
+        }
+    }
+    else if (opcode == COMMAND_BENCHMARK)
+    {
+        if (value == 0 || benchmarking)
+        {
+            result = COMMAND_STATUS_REJECTED;
+        }
+        else
+        {
+            Command_StartBenchmark(value);
+            result = COMMAND_STATUS_OK;
+        }
+    }
+    else
+    {
+        // The opcodes are the settings of the acquisition
+        result = (Acquisition_Configure(opcode, value) == NO_ERROR) ?
+                 COMMAND_STATUS_OK : COMMAND_STATUS_REJECTED;
+    }
+
+    Stream_SendStatus(opcode, result, value);
+}
+
+void Command_Task(void)
+{
+    // Without confirmation the host is still at the old rate
+    if (confirming && Timing_NowUs() - switched_at > COMMAND_CONFIRM_US)
+    {
+        confirming = 0;
+        Baud_SetProfile(previous_profile);
+        received = 0;
+        Stream_SendStatus(COMMAND_SET_BAUD, COMMAND_STATUS_TIMEOUT, previous_profile);
+    }
+
+    Command_CheckBenchmark();
+
+    uint8_t data;
+
+    while (Stream_ReadRx(&data))
+    {
+        last_byte = Timing_NowUs();
+
+        if (received == 0 && data != COMMAND_SYNC)
+        {
+            continue;   // Look for the beginning of a packet
+        }
+
+        packet[received++] = data;
+
+        if (received == COMMAND_PACKET_SIZE)
+        {
+            if ((packet[0] ^ packet[1] ^ packet[2]) == packet[3])
+            {
+                confirming = 0; // A valid packet: the host is at the new rate
+            }
+            Command_Execute();
+            received = 0;
+        }
+    }
+
+    // A packet interrupted halfway is discarded, so the parser can't stay out of sync.
+    // Checked once the ring is empty, the bytes queued while the loop was busy are not late
+    if (received > 0 && Timing_NowUs() - last_byte > COMMAND_TIMEOUT_US)
+    {
+        received = 0;
+    }
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,90 @@
+/**
+*   \file Command.h
+*   \brief Binary command channel on the RX line of the UART.
+*
+*   Every command is a packet of four bytes:
+*   [COMMAND_SYNC][opcode][value][checksum], where the checksum is the XOR
+*   of the first three bytes. The opcodes from 0x01 to 0x0E change the
+*   corresponding ACQ_CONFIG_xxx setting of the acquisition. Every packet is
+*   acknowledged with a STREAM_TYPE_STATUS frame carrying the opcode, one
+*   of the COMMAND_STATUS_xxx results and the value.
+*
+*   The bytes are collected in the background in the reception ring of
+*   Stream.h, so the host can send several packets without waiting for
+*   the status frames, up to STREAM_RX_BUFFER_SIZE / COMMAND_PACKET_SIZE - 1
+*   while a command keeps the main loop busy (register writes,
+*   calibration, clock switch). The bytes received across a change of the
+*   baud rate or of the clock are discarded. An incomplete packet is
+*   discarded COMMAND_TIMEOUT_US after its last byte. Acquisitions with no
+*   sensor apply the settings at once, see Acquisition_Configure().
+*
+*   COMMAND_SET_BAUD is acknowledged at the old rate, then the device
+*   switches to the new profile and waits for any valid packet at the new
+*   rate (e.g. a COMMAND_PING). If nothing arrives within
+*   COMMAND_CONFIRM_US, the old profile is restored and reported with
+*   COMMAND_STATUS_TIMEOUT, so host and device can't lose each other.
+*
+*   COMMAND_BENCHMARK lets the acquisition run with its settings for the
+*   requested time and reports the highest sample rate, summed over the
+*   sensors, that the CPU could process: the samples acquired over the
+*   cycles of the main loop spent working, less the time waited for room
+*   in the UART ring. The host repeats it for every clock profile
+*   (ACQ_CONFIG_CLOCK) and for the formats and filters of interest.
+*
+*   \author Simone Fiorani
+*   \date 2020
+*/
+
+#ifndef __COMMAND_H
+    #define __COMMAND_H
+
+    #include "cytypes.h"
+
+    /**
+    *   \brief First byte of every command packet.
+    */
+    #define COMMAND_SYNC 0x55
+
+    /**
+    *   \brief Size of a command packet.
+    */
+    #define COMMAND_PACKET_SIZE 4
+
+    /**
+    *   \brief Time after which an incomplete packet is discarded, in us.
+    */
+    #define COMMAND_TIMEOUT_US 20000
+
+    /**
+    *   \brief Time given to the host to confirm a new baud rate, in us.
+    */
+    #define COMMAND_CONFIRM_US 1000000
+
+    /**
+    *   \brief Duration of one unit of the throughput test, in us.
+    */
+    #define COMMAND_TEST_UNIT_US 100000
+
+    #define COMMAND_PING 0x10       ///< Reply with a status frame, the value is echoed
+    #define COMMAND_SET_BAUD 0x20   ///< Switch to one of the BAUD_PROFILE_xxx profiles
+    #define COMMAND_SELF_TEST 0x21  ///< Stream the test pattern for value x 100 ms and report the throughput
+    #define COMMAND_TRIGGER 0x22    ///< Trigger the armed capture, the value is ignored
+    #define COMMAND_TELEMETRY 0x23  ///< Period of the telemetry in units of 100 ms, 0 to stop it
+    #define COMMAND_SENSOR_TEST 0x24    ///< Not a command: status sent at boot with the self-test of a sensor, the value is its channel ID
+    #define COMMAND_BENCHMARK 0x25  ///< Measure the processing for value x 100 ms and report the highest sample rate
+
+    #define COMMAND_STATUS_OK 0x00          ///< Command accepted
+    #define COMMAND_STATUS_REJECTED 0x01    ///< Unknown opcode, value out of range or another change waiting
+    #define COMMAND_STATUS_CHECKSUM 0x02    ///< Corrupted packet, nothing changed
+    #define COMMAND_STATUS_TIMEOUT 0x03     ///< New baud rate not confirmed, the value is the restored profile
+    #define COMMAND_STATUS_FAILED 0x04      ///< Self-test of the sensor out of the limits of the datasheet
+
+    /**
+    *   \brief Parse the bytes received by the UART and execute the commands.
+    *
+    *   Must be called continuously from the main loop.
+    */
+    void Command_Task(void);
+
+#endif
+/* [] END OF FILE */
@@ -0,0 +1,73 @@
+/*
+* This file includes the source code of the statistics
+* of the accelerometer axes.
+*/
+
+#include "Features.h"
+#include "FixedMath.h"
+
+void Features_Init(Features* features)
+{
+    for (uint8_t axis = 0; axis < FEATURES_AXES; axis++)
+    {
+        features->sum[axis] = 0;
+        features->sum_sq[axis] = 0;
+        features->min[axis] = INT16_MAX;
+        features->max[axis] = INT16_MIN;
+    }
+    features->count = 0;
+}
+
+uint8_t Features_Add(Features* features, const uint8_t* sample, uint16_t window, Features_Axis* result)
+{
+    for (uint8_t axis = 0; axis < FEATURES_AXES; axis++)
+    {
+        int16_t value = (int16)((sample[2*axis] | (sample[2*axis+1]<<8)))>>4;   // Right aligned 12 bit value
+
+        features->sum[axis] += value;
+        features->sum_sq[axis] += (int32_t)value * value;
+
+        if (value < features->min[axis])
+        {
+            features->min[axis] = value;
+        }
+        if (value > features->max[axis])
+        {
+            features->max[axis] = value;
+        }
+    }
+
+    if (++features->count < window)
+    {
+        return 0;
+    }
+
+    for (uint8_t axis = 0; axis < FEATURES_AXES; axis++)
+    {
+        Features_Axis* out = &result[axis];
+        int32_t n = features->count;
+
+        // n^2 var = n sum(x^2) - sum(x)^2, exact in 64 bit
+        int64_t sum = features->sum[axis];
+        uint64_t scaled_var = (uint64_t)(n * (int64_t)features->sum_sq[axis] - sum * sum);
+
+        out->mean = (int16_t)(features->sum[axis] / n);
+        out->rms = FixedMath_Sqrt((uint32_t)(scaled_var / ((uint64_t)n * n)));
+        out->min = features->min[axis];
+        out->max = features->max[axis];
+        out->p2p = (uint16_t)(features->max[axis] - features->min[axis]);
+
+        int32_t peak = features->max[axis] - out->mean;
+        if (out->mean - features->min[axis] > peak)
+        {
+            peak = out->mean - features->min[axis];
+        }
+        out->crest = (out->rms != 0) ? (uint16_t)((peak << FEATURES_CREST_Q) / out->rms) : 0;
+    }
+
+    Features_Init(features);
+
+    return 1;
+}
+
+/* [] END OF FILE */
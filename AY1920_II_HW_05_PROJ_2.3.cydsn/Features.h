@@ -0,0 +1,72 @@
+/**
+*   \file Features.h
+*   \brief Statistics of the accelerometer axes over a window of samples.
+*
+*   Instead of every sample, one set of features per axis is produced for
+*   every window: mean, RMS, minimum, maximum, peak to peak and crest
+*   factor. The RMS and the crest factor refer to the vibration around the
+*   mean, so that gravity doesn't hide them. All the values are computed in
+*   integer arithmetic on the right aligned 12 bit samples.
+*
+*   \author Simone Fiorani
+*   \date 2020
+*/
+
+#ifndef __FEATURES_H
+    #define __FEATURES_H
+
+    #include "cytypes.h"
+
+    /**
+    *   \brief Number of axes of a sample.
+    */
+    #define FEATURES_AXES 3
+
+    /**
+    *   \brief Fractional bits of the crest factor.
+    */
+    #define FEATURES_CREST_Q 8
+
+    /**
+    *   \brief Features of an axis over a window, in 12 bit digits.
+    */
+    typedef struct {
+        int16_t mean;       ///< Average value
+        uint16_t rms;       ///< RMS of the deviation from the mean
+        int16_t min;        ///< Smallest value
+        int16_t max;        ///< Largest value
+        uint16_t p2p;       ///< Peak to peak
+        uint16_t crest;     ///< Largest deviation from the mean over the RMS, in Q8
+    } Features_Axis;
+
+    /**
+    *   \brief Accumulators of the window being collected for a sensor.
+    */
+    typedef struct {
+        int32_t sum[FEATURES_AXES];         ///< Sum of the samples
+        uint64_t sum_sq[FEATURES_AXES];     ///< Sum of the squares of the samples
+        int16_t min[FEATURES_AXES];         ///< Smallest sample
+        int16_t max[FEATURES_AXES];         ///< Largest sample
+        uint16_t count;                     ///< Samples collected so far
+    } Features;
+
+    /**
+    *   \brief Discard the samples collected so far.
+    *
+    *   \param features Accumulators of the sensor.
+    */
+    void Features_Init(Features* features);
+
+    /**
+    *   \brief Add a sample to the window.
+    *
+    *   \param features Accumulators of the sensor.
+    *   \param sample LSB and MSB of the X, Y and Z axis, as read from the sensor.
+    *   \param window Number of samples of the window.
+    *   \param result Features of the three axes, written when the window is complete.
+    *   \return 1 if the window is complete and `result` has been written.
+    */
+    uint8_t Features_Add(Features* features, const uint8_t* sample, uint16_t window, Features_Axis* result);
+
+#endif
+/* [] END OF FILE */
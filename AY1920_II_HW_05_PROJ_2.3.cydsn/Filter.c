@@ -0,0 +1,82 @@
+/*
+* This file includes the source code of the fixed point
+* filter and decimation stage.
+*/
+
+#include "Filter.h"
+#include "RamCode.h"
+
+void Filter_Init(Filter* filter, const Filter_Biquad* coeffs, uint8_t stages, uint8_t decimation)
+{
+    filter->coeffs = coeffs;
+    filter->stages = (stages > FILTER_MAX_STAGES) ? FILTER_MAX_STAGES : stages;
+    filter->decimation = (decimation == 0) ? 1 : decimation;
+    filter->count = 0;
+
+    for (uint8_t s = 0; s < FILTER_MAX_STAGES; s++)
+    {
+        for (uint8_t axis = 0; axis < FILTER_AXES; axis++)
+        {
+            filter->x[s][axis][0] = filter->x[s][axis][1] = 0;
+            filter->y[s][axis][0] = filter->y[s][axis][1] = 0;
+        }
+    }
+}
+
+RAM_CODE uint8_t Filter_Process(Filter* filter, const uint8_t* in, uint8_t* out)
+{
+    int32_t value[FILTER_AXES];
+
+    for (uint8_t axis = 0; axis < FILTER_AXES; axis++)
+    {
+        value[axis] = (int16)(in[2*axis] | (in[2*axis+1]<<8)) * (1 << FILTER_GUARD_BITS);
+
+        for (uint8_t s = 0; s < filter->stages; s++)
+        {
+            const Filter_Biquad* c = &filter->coeffs[s];
+            int32_t* x = filter->x[s][axis];
+            int32_t* y = filter->y[s][axis];
+
+            int64_t acc = (int64_t)c->b0 * value[axis]
+                        + (int64_t)c->b1 * x[0]
+                        + (int64_t)c->b2 * x[1]
+                        - (int64_t)c->a1 * y[0]
+                        - (int64_t)c->a2 * y[1];
+
+            x[1] = x[0];
+            x[0] = value[axis];
+            y[1] = y[0];
+            y[0] = (int32_t)((acc + (1 << (FILTER_Q - 1))) >> FILTER_Q);   // Rounded back to the format of the state
+
+            value[axis] = y[0];
+        }
+    }
+
+    // Every input goes through the filter, only the decimated ones are kept
+    if (++filter->count < filter->decimation)
+    {
+        return 0;
+    }
+    filter->count = 0;
+
+    for (uint8_t axis = 0; axis < FILTER_AXES; axis++)
+    {
+        int32_t v = (value[axis] + (1 << (FILTER_GUARD_BITS - 1))) >> FILTER_GUARD_BITS;   // Rounded to the sample format
+
+        if (v > INT16_MAX)
+        {
+            v = INT16_MAX;  // The overshoot of a full scale step is saturated
+        }
+        else if (v < INT16_MIN)
+        {
+            v = INT16_MIN;
+        }
+
+        out[2*axis] = (uint8_t)(v & 0xFF);
+        out[2*axis+1] = (uint8_t)(v >> 8);
+    }
+
+    return 1;
+}
+
+/* [] END OF FILE */
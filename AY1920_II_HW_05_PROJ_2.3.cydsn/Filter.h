@@ -0,0 +1,94 @@
+/**
+*   \file Filter.h
+*   \brief Fixed point low pass filter and decimation of the accelerometer samples.
+*
+*   A cascade of biquad sections in direct form I filters the three axes,
+*   then only one sample every `decimation` is kept. The sensor can run at
+*   a high data rate, so that the analog bandwidth is limited by the filter
+*   and not folded back by aliasing, while the UART only carries the
+*   decimated samples.
+*
+*   Coefficients are in Q14 with a0 = 1. Samples keep the left aligned
+*   format of the sensor, the state is in 32 bit and the products are
+*   accumulated in 64 bit, so sections with poles close to the unit circle
+*   can't overflow. The state keeps FILTER_GUARD_BITS below the LSB of the
+*   samples: the rounding of a section is amplified by its recursive part,
+*   up to 54 times at DC for ACQ_FILTER_LP30_D12, and would otherwise leave
+*   a dead band of several LSB around the input.
+*
+*   \author Simone Fiorani
+*   \date 2020
+*/
+
+#ifndef __FILTER_H
+    #define __FILTER_H
+
+    #include "cytypes.h"
+
+    /**
+    *   \brief Fractional bits of the coefficients.
+    */
+    #define FILTER_Q 14
+
+    /**
+    *   \brief Fractional bits of the state below the LSB of the samples.
+    */
+    #define FILTER_GUARD_BITS 8
+
+    /**
+    *   \brief Largest number of biquad sections of a cascade.
+    */
+    #define FILTER_MAX_STAGES 2
+
+    /**
+    *   \brief Number of axes of a sample.
+    */
+    #define FILTER_AXES 3
+
+    /**
+    *   \brief Coefficients of a biquad section, in Q14.
+    *
+    *   y[n] = b0 x[n] + b1 x[n-1] + b2 x[n-2] - a1 y[n-1] - a2 y[n-2]
+    */
+    typedef struct {
+        int16_t b0;
+        int16_t b1;
+        int16_t b2;
+        int16_t a1;
+        int16_t a2;
+    } Filter_Biquad;
+
+    /**
+    *   \brief Filter and decimation stage of a sensor.
+    */
+    typedef struct {
+        const Filter_Biquad* coeffs;                        ///< Sections of the cascade
+        uint8_t stages;                                     ///< Number of sections, 0 to only decimate
+        uint8_t decimation;                                 ///< One output every `decimation` inputs
+        uint8_t count;                                      ///< Inputs since the last output
+        int32_t x[FILTER_MAX_STAGES][FILTER_AXES][2];       ///< Previous inputs of every section, with the guard bits
+        int32_t y[FILTER_MAX_STAGES][FILTER_AXES][2];       ///< Previous outputs of every section, with the guard bits
+    } Filter;
+
+    /**
+    *   \brief Configure a filter and clear its state.
+    *
+    *   \param filter Filter to be configured.
+    *   \param coeffs Array of `stages` sections, it must stay valid while the filter is used.
+    *   \param stages Number of sections, at most FILTER_MAX_STAGES.
+    *   \param decimation Decimation factor, 1 to keep all the samples.
+    */
+    void Filter_Init(Filter* filter, const Filter_Biquad* coeffs, uint8_t stages, uint8_t decimation);
+
+    /**
+    *   \brief Filter one sample.
+    *
+    *   \param filter Filter of the sensor.
+    *   \param in LSB and MSB of the X, Y and Z axis, as read from the sensor.
+    *   \param out Filtered sample in the same format, it can be the same buffer as `in`.
+    *   \return 1 if an output sample has been written, 0 if it has been dropped by the decimation.
+    */
+    uint8_t Filter_Process(Filter* filter, const uint8_t* in, uint8_t* out);
+
+#endif
+/* [] END OF FILE */
@@ -0,0 +1,130 @@
+/*
+* This file includes the source code of the integer
+* math helpers.
+*/
+
+#include "FixedMath.h"
+#include <stddef.h>
+
+/**
+*   \brief Fractional bits of the angles of the CORDIC, in centi-degrees.
+*/
+#define FIXED_MATH_ANGLE_SHIFT 8
+
+/**
+*   \brief Inverse of the gain of the CORDIC iterations (1.6468) in Q15.
+*/
+#define FIXED_MATH_CORDIC_INV_GAIN 19898
+
+/**
+*   \brief Range of the largest component during the iterations, so the growth can't overflow.
+*/
+#define FIXED_MATH_CORDIC_MIN (1l << 27)
+#define FIXED_MATH_CORDIC_MAX (1l << 28)
+
+// atan(2^-i) in centi-degrees, FIXED_MATH_ANGLE_SHIFT fractional bits
+static const int32_t atan_table[FIXED_MATH_CORDIC_STEPS] = {
+    1152000, 680065, 359328, 182400, 91554, 45822, 22916, 11459,
+    5730, 2865, 1432, 716, 358, 179, 90, 45
+};
+
+uint16_t FixedMath_Sqrt(uint32_t value)
+{
+    uint32_t root = 0;
+    uint32_t bit = 1ul << 30;
+
+    while (bit > value)
+    {
+        bit >>= 2;
+    }
+
+    // One bit of the result for every iteration
+    while (bit != 0)
+    {
+        if (value >= root + bit)
+        {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return (uint16_t)root;
+}
+
+int16_t FixedMath_Atan2(int32_t y, int32_t x, uint32_t* magnitude)
+{
+    int32_t angle = 0;
+    int8_t shift = 0;
+
+    if (x == 0 && y == 0)
+    {
+        if (magnitude != NULL)
+        {
+            *magnitude = 0;
+        }
+        return 0;
+    }
+
+    // The iterations converge for x >= 0, the left half plane is rotated by 180 degrees
+    if (x < 0)
+    {
+        angle = (y >= 0) ? (18000l << FIXED_MATH_ANGLE_SHIFT) : -(18000l << FIXED_MATH_ANGLE_SHIFT);
+        x = -x;
+        y = -y;
+    }
+
+    // The vector is scaled to use the whole resolution of the iterations
+    uint32_t largest = (x > ((y < 0) ? -y : y)) ? x : ((y < 0) ? -y : y);
+    while (largest >= FIXED_MATH_CORDIC_MAX)
+    {
+        x >>= 1;
+        y >>= 1;
+        largest >>= 1;
+        shift--;
+    }
+    while (largest < FIXED_MATH_CORDIC_MIN)
+    {
+        x *= 2;
+        y *= 2;
+        largest <<= 1;
+        shift++;
+    }
+
+    // Every step rotates the vector toward the X axis and accumulates the rotation
+    for (uint8_t i = 0; i < FIXED_MATH_CORDIC_STEPS; i++)
+    {
+        int32_t dx = y >> i;
+        int32_t dy = x >> i;
+
+        if (y > 0)
+        {
+            x += dx;
+            y -= dy;
+            angle += atan_table[i];
+        }
+        else
+        {
+            x -= dx;
+            y += dy;
+            angle -= atan_table[i];
+        }
+    }
+
+    if (magnitude != NULL)
+    {
+        uint32_t length = ((uint64_t)x * FIXED_MATH_CORDIC_INV_GAIN) >> 15;
+        *magnitude = (shift > 0) ? ((length + (1ul << (shift - 1))) >> shift) : (length << -shift);
+    }
+
+    // Rounded to the nearest centi-degree
+    angle = (angle + (1 << (FIXED_MATH_ANGLE_SHIFT - 1))) >> FIXED_MATH_ANGLE_SHIFT;
+
+    return (int16_t)angle;
+}
+
+/* [] END OF FILE */
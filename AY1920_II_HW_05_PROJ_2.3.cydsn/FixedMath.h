@@ -0,0 +1,41 @@
+/**
+*   \file FixedMath.h
+*   \brief Integer math helpers shared by the signal processing modules.
+*
+*   \author Simone Fiorani
+*   \date 2020
+*/
+
+#ifndef __FIXED_MATH_H
+    #define __FIXED_MATH_H
+
+    #include "cytypes.h"
+
+    /**
+    *   \brief Iterations of the CORDIC, the last rotation is below 0.002 degrees.
+    */
+    #define FIXED_MATH_CORDIC_STEPS 16
+
+    /**
+    *   \brief Integer square root, rounded down.
+    *
+    *   Computed one bit at a time with shifts and subtractions only, in at
+    *   most 16 iterations.
+    *   \param value Radicand.
+    */
+    uint16_t FixedMath_Sqrt(uint32_t value);
+
+    /**
+    *   \brief Angle of a vector in centi-degrees, from -18000 to 18000.
+    *
+    *   Computed with FIXED_MATH_CORDIC_STEPS iterations of the CORDIC in
+    *   vectoring mode, with shifts and additions only. The error is below
+    *   0.01 degrees.
+    *   \param y Y component of the vector.
+    *   \param x X component of the vector, |x| and |y| below 2^30.
+    *   \param magnitude If not NULL, the length of the vector, a free product of the iterations.
+    */
+    int16_t FixedMath_Atan2(int32_t y, int32_t x, uint32_t* magnitude);
+
+#endif
+/* [] END OF FILE */
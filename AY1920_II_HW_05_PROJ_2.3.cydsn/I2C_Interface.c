@@ -1,6 +1,13 @@
 /*
 * This file includes all the required source code to interface
 * the I2C peripheral.
+*
+* Transactions use the interrupt based API of the I2C_Master component
+* and are carried on by a small state machine checked against a
+* deadline, so every call returns in bounded time even if a slave holds
+* the bus. Failed transactions are retried according to the retry
+* policy, timeouts trigger a bus recovery. The blocking functions simply
+* run the state machine until the transaction is completed.
 */
 
 /**
@@ -17,19 +24,265 @@
     #define DEVICE_UNCONNECTED 0
 #endif
 
-#include "I2C_Interface.h" 
+/**
+*   \brief Maximum number of data bytes of a multiple write.
+*/
+#define I2C_MAX_WRITE_COUNT 32
+
+/**
+*   \brief Fixed time added to the timeout of every transaction phase, in us.
+*/
+#define I2C_TIMEOUT_MARGIN_US 200
+
+/**
+*   \brief Half period of SCL during the bus recovery sequence, in us (~100 kHz).
+*/
+#define I2C_RECOVERY_HALF_PERIOD_US 5
+
+/**
+*   \brief Number of SCL pulses of the bus recovery sequence.
+*/
+#define I2C_RECOVERY_CLOCKS 9
+
+/**
+*   \brief States of the transaction.
+*/
+#define I2C_STATE_IDLE 0
+#define I2C_STATE_WRITE 1
+#define I2C_STATE_READ 2
+#define I2C_STATE_BACKOFF 3
+
+#include "I2C_Interface.h"
 #include "I2C_Master.h"
+#include "RamCode.h"
+#include "SCL_1.h"
+#include "SDA_1.h"
+#include "Timing.h"
+
+    static I2C_RetryPolicy policy = {
+        I2C_DEFAULT_MAX_RETRIES,
+        I2C_DEFAULT_BACKOFF_US,
+        I2C_DEFAULT_TIMEOUT_US_PER_BYTE
+    };
+
+    static I2C_Stats stats;
+
+    /**
+    *   \brief Transaction in progress.
+    */
+    static struct {
+        uint8_t state;                                  // One of the I2C_STATE_xxx values
+        uint8_t device_address;
+        uint8_t write_data[I2C_MAX_WRITE_COUNT + 1];    // Register address followed by the data to be written
+        uint8_t write_count;
+        uint8_t* read_data;
+        uint8_t read_count;
+        uint8_t retries_left;
+        uint8_t probe;                                  // Presence check: a NAK is not an error
+        uint32_t backoff_us;
+        uint32_t phase_start;                           // Cycle counter at the beginning of the phase
+        uint32_t phase_cycles;                          // Duration allowed to the phase
+        ErrorCode result;                               // Result of the last completed transaction
+    } xfer;
+
+    /**
+    *   \brief Start a phase of the transaction.
+    *
+    *   \param state I2C_STATE_WRITE or I2C_STATE_READ.
+    *   \retval Returns I2C_Master_MSTR_NO_ERROR if the component accepted the phase.
+    */
+    static uint8_t I2C_StartPhase(uint8_t state)
+    {
+        uint8_t error;
+
+        I2C_Master_MasterClearStatus();
+        if (state == I2C_STATE_WRITE)
+        {
+            error = I2C_Master_MasterWriteBuf(xfer.device_address,
+                                              xfer.write_data,
+                                              xfer.write_count,
+                                              xfer.read_count ? I2C_Master_MODE_NO_STOP : I2C_Master_MODE_COMPLETE_XFER);
+        }
+        else
+        {
+            error = I2C_Master_MasterReadBuf(xfer.device_address,
+                                             xfer.read_data,
+                                             xfer.read_count,
+                                             I2C_Master_MODE_REPEAT_START);
+        }
+
+        uint8_t byte_count = (state == I2C_STATE_WRITE ? xfer.write_count : xfer.read_count) + 1;
+
+        xfer.state = state;
+        xfer.phase_start = Timing_Now();
+        xfer.phase_cycles = TIMING_US_TO_CYCLES((uint32_t)policy.timeout_us_per_byte * byte_count + I2C_TIMEOUT_MARGIN_US);
+
+        return error;
+    }
+
+    /**
+    *   \brief Handle a failed attempt: recovery, retry or final error.
+    *
+    *   \param timeout True (>0) if the attempt failed because of the timeout.
+    */
+    static void I2C_Fail(uint8_t timeout)
+    {
+        if (timeout)
+        {
+            if (!xfer.probe)
+            {
+                stats.timeouts++;
+            }
+            I2C_Peripheral_RecoverBus();
+        }
+        else if (!xfer.probe)
+        {
+            stats.nak_errors++;
+        }
+
+        if (xfer.retries_left == 0)
+        {
+            if (!xfer.probe)
+            {
+                stats.failures++;
+            }
+            xfer.result = ERROR;
+            xfer.state = I2C_STATE_IDLE;
+            return;
+        }
+
+        stats.retries++;
+        xfer.retries_left--;
+        xfer.state = I2C_STATE_BACKOFF;
+        xfer.phase_start = Timing_Now();
+        xfer.phase_cycles = TIMING_US_TO_CYCLES(xfer.backoff_us);
+        xfer.backoff_us *= 2;
+    }
+
+    /**
+    *   \brief Start a new attempt of the transaction.
+    */
+    static void I2C_StartAttempt(void)
+    {
+        if (I2C_StartPhase(I2C_STATE_WRITE) != I2C_Master_MSTR_NO_ERROR)
+        {
+            // Bus busy: most likely held by a slave, handled as a timeout
+            I2C_Fail(1);
+        }
+    }
+
+    /**
+    *   \brief Begin a transaction with the data already copied in xfer.write_data.
+    */
+    static void I2C_Begin(uint8_t device_address,
+                          uint8_t write_count,
+                          uint8_t* read_data,
+                          uint8_t read_count,
+                          uint8_t probe)
+    {
+        xfer.device_address = device_address;
+        xfer.write_count = write_count;
+        xfer.read_data = read_data;
+        xfer.read_count = read_count;
+        xfer.probe = probe;
+        xfer.retries_left = probe ? 0 : policy.max_retries;
+        xfer.backoff_us = policy.backoff_us;
+        xfer.result = NO_ERROR;
+
+        if (!probe)
+        {
+            stats.transactions++;
+        }
+
+        I2C_StartAttempt();
+    }
+
+    /**
+    *   \brief Run the transaction until it is completed.
+    */
+    static ErrorCode I2C_Wait(void)
+    {
+        ErrorCode result;
+
+        while (I2C_Peripheral_Poll(&result))
+        {
+        }
+
+        return result;
+    }
+
+    /**
+    *   \brief Wait for the end of a previous transaction, if any.
+    */
+    static void I2C_WaitIdle(void)
+    {
+        (void)I2C_Wait();
+    }
 
-    ErrorCode I2C_Peripheral_Start(void) 
+    RAM_CODE uint8_t I2C_Peripheral_Poll(ErrorCode* result)
     {
+        uint8_t status;
+
+        switch (xfer.state)
+        {
+            case I2C_STATE_WRITE:
+            case I2C_STATE_READ:
+                status = I2C_Master_MasterStatus();
+
+                if (status & I2C_Master_MSTAT_ERR_MASK)
+                {
+                    I2C_Fail(0);
+                }
+                else if (status & (xfer.state == I2C_STATE_WRITE ? I2C_Master_MSTAT_WR_CMPLT : I2C_Master_MSTAT_RD_CMPLT))
+                {
+                    if (xfer.state == I2C_STATE_WRITE && xfer.read_count)
+                    {
+                        // Register address sent: restart and read the data
+                        if (I2C_StartPhase(I2C_STATE_READ) != I2C_Master_MSTR_NO_ERROR)
+                        {
+                            I2C_Fail(1);
+                        }
+                    }
+                    else
+                    {
+                        xfer.result = NO_ERROR;
+                        xfer.state = I2C_STATE_IDLE;
+                    }
+                }
+                else if (Timing_Elapsed(xfer.phase_start) > xfer.phase_cycles)
+                {
+                    I2C_Fail(1);
+                }
+                break;
+
+            case I2C_STATE_BACKOFF:
+                if (Timing_Elapsed(xfer.phase_start) >= xfer.phase_cycles)
+                {
+                    I2C_StartAttempt();
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        *result = xfer.result;
+        return xfer.state != I2C_STATE_IDLE;
+    }
+
+    ErrorCode I2C_Peripheral_Start(void)
+    {
+        // Start the time base of the timeouts
+        Timing_Start();
+
         // Start I2C peripheral
-        I2C_Master_Start();  
-        
+        I2C_Master_Start();
+
         // Return no error since start function does not return any error
         return NO_ERROR;
     }
-    
-    
+
+
     ErrorCode I2C_Peripheral_Stop(void)
     {
         // Stop I2C peripheral
@@ -38,143 +291,158 @@
         return NO_ERROR;
     }
 
-    ErrorCode I2C_Peripheral_ReadRegister(uint8_t device_address, 
+    ErrorCode I2C_Peripheral_ReadRegister(uint8_t device_address,
                                             uint8_t register_address,
                                             uint8_t* data)
     {
-        // Send start condition
-        uint8_t error = I2C_Master_MasterSendStart(device_address,I2C_Master_WRITE_XFER_MODE);
-        if (error == I2C_Master_MSTR_NO_ERROR)
-        {
-            // Write address of register to be read
-            error = I2C_Master_MasterWriteByte(register_address);
-            if (error == I2C_Master_MSTR_NO_ERROR)
-            {
-                // Send restart condition
-                error = I2C_Master_MasterSendRestart(device_address, I2C_Master_READ_XFER_MODE);
-                if (error == I2C_Master_MSTR_NO_ERROR)
-                {
-                    // Read data without acknowledgement
-                    *data = I2C_Master_MasterReadByte(I2C_Master_NAK_DATA);
-                    // Send stop condition and return no error
-                    I2C_Master_MasterSendStop();
-                }
-            }
-        }
-        // Send stop condition if something went wrong
-        I2C_Master_MasterSendStop();
-        // Return error code
-        return error ? ERROR : NO_ERROR;
+        I2C_WaitIdle();
+
+        // Write address of register to be read, then read it after a restart
+        xfer.write_data[0] = register_address;
+        I2C_Begin(device_address, 1, data, 1, 0);
+
+        return I2C_Wait();
     }
-    
+
     ErrorCode I2C_Peripheral_ReadRegisterMulti(uint8_t device_address,
                                                 uint8_t register_address,
                                                 uint8_t register_count,
                                                 uint8_t* data)
     {
-        // Send start condition
-        uint8_t error = I2C_Master_MasterSendStart(device_address,I2C_Master_WRITE_XFER_MODE);
-        if (error == I2C_Master_MSTR_NO_ERROR)
+        I2C_WaitIdle();
+
+        I2C_Peripheral_StartReadRegisterMulti(device_address, register_address, register_count, data);
+
+        return I2C_Wait();
+    }
+
+    ErrorCode I2C_Peripheral_StartReadRegisterMulti(uint8_t device_address,
+                                                    uint8_t register_address,
+                                                    uint8_t register_count,
+                                                    uint8_t* data)
+    {
+        if (xfer.state != I2C_STATE_IDLE)
         {
-            // Write address of register to be read with the MSB equal to 1
-            register_address |= 0x80;
-            error = I2C_Master_MasterWriteByte(register_address);
-            if (error == I2C_Master_MSTR_NO_ERROR)
-            {
-                // Send restart condition
-                error = I2C_Master_MasterSendRestart(device_address, I2C_Master_READ_XFER_MODE);
-                if (error == I2C_Master_MSTR_NO_ERROR)
-                {
-                    // Continue reading until we have register to read
-                    uint8_t counter = register_count;
-                    while(counter>1)
-                    {
-                        data[register_count-counter] =
-                            I2C_Master_MasterReadByte(I2C_Master_ACK_DATA);
-                        counter--;
-                    }
-                    // Read last data without acknowledgement
-                    data[register_count-1]
-                        = I2C_Master_MasterReadByte(I2C_Master_NAK_DATA);
-                }
-            }
+            return ERROR;
         }
-        // Send stop condition
-        I2C_Master_MasterSendStop();
-        // Return error code
-        return error ? ERROR : NO_ERROR;
+
+        // Write address of register to be read with the MSB equal to 1
+        xfer.write_data[0] = register_address | 0x80;
+        I2C_Begin(device_address, 1, data, register_count, 0);
+
+        return NO_ERROR;
     }
-    
+
     ErrorCode I2C_Peripheral_WriteRegister(uint8_t device_address,
                                             uint8_t register_address,
                                             uint8_t data)
     {
-        // Send start condition
-        uint8_t error = I2C_Master_MasterSendStart(device_address, I2C_Master_WRITE_XFER_MODE);
-        if (error == I2C_Master_MSTR_NO_ERROR)
-        {
-            // Write register address
-            error = I2C_Master_MasterWriteByte(register_address);
-            if (error == I2C_Master_MSTR_NO_ERROR)
-            {
-                // Write byte of interest
-                error = I2C_Master_MasterWriteByte(data);
-            }
-        }
-        // Send stop condition
-        I2C_Master_MasterSendStop();
-        // Return error code
-        return error ? ERROR : NO_ERROR;
+        I2C_WaitIdle();
+
+        // Register address followed by the byte of interest
+        xfer.write_data[0] = register_address;
+        xfer.write_data[1] = data;
+        I2C_Begin(device_address, 2, NULL, 0, 0);
+
+        return I2C_Wait();
     }
-    
+
     ErrorCode I2C_Peripheral_WriteRegisterMulti(uint8_t device_address,
                                             uint8_t register_address,
                                             uint8_t register_count,
                                             uint8_t* data)
     {
-        // Send start condition
-        uint8_t error = I2C_Master_MasterSendStart(device_address, I2C_Master_WRITE_XFER_MODE);
-        if (error == I2C_Master_MSTR_NO_ERROR)
+        if (register_count > I2C_MAX_WRITE_COUNT)
         {
-            // Write register address
-            error = I2C_Master_MasterWriteByte(register_address);
-            if (error == I2C_Master_MSTR_NO_ERROR)
-            {
-                // Continue writing until we have data to write
-                uint8_t counter = register_count;
-                while(counter >= 0)
-                {
-                     error =
-                        I2C_Master_MasterWriteByte(data[register_count-counter]);
-                    if (error != I2C_Master_MSTR_NO_ERROR)
-                    {
-                        // Send stop condition
-                        I2C_Master_MasterSendStop();
-                        // Return error code
-                        return ERROR;
-                    }
-                    counter--;
-                }
-            }
+            return ERROR;
+        }
+
+        I2C_WaitIdle();
+
+        // Address of the first register with the MSB equal to 1, then the data
+        xfer.write_data[0] = register_address | 0x80;
+        for (uint8_t i = 0; i < register_count; i++)
+        {
+            xfer.write_data[i + 1] = data[i];
         }
-        // Send stop condition in case something didn't work out correctly
-        I2C_Master_MasterSendStop();
-        // Return error code
-        return error ? ERROR : NO_ERROR;
+        I2C_Begin(device_address, register_count + 1, NULL, 0, 0);
+
+        return I2C_Wait();
     }
-    
-    
+
+
     uint8_t I2C_Peripheral_IsDeviceConnected(uint8_t device_address)
     {
-        // Send a start condition followed by a stop condition
-        uint8_t error = I2C_Master_MasterSendStart(device_address, I2C_Master_WRITE_XFER_MODE);
-        I2C_Master_MasterSendStop();
-        // If no error generated during stop, device is connected
-        if (error == I2C_Master_MSTR_NO_ERROR)
+        I2C_WaitIdle();
+
+        // Send the address alone: a missing device is not an error, so no retries
+        I2C_Begin(device_address, 0, NULL, 0, 1);
+
+        // If the address has been acknowledged, device is connected
+        if (I2C_Wait() == NO_ERROR)
         {
             return DEVICE_CONNECTED;
         }
         return DEVICE_UNCONNECTED;
     }
 
-/* [] END OF FILE */
\ No newline at end of file
+    void I2C_Peripheral_SetRetryPolicy(const I2C_RetryPolicy* new_policy)
+    {
+        policy = *new_policy;
+    }
+
+    const I2C_Stats* I2C_Peripheral_GetStats(void)
+    {
+        return &stats;
+    }
+
+    ErrorCode I2C_Peripheral_RecoverBus(void)
+    {
+        stats.recoveries++;
+
+        // Stop the component: this also resets its state machine
+        I2C_Master_Stop();
+
+        // Drive the pins from the data registers instead of the I2C block
+        uint8_t interrupt_state = CyEnterCriticalSection();
+        SCL_1_BYP &= (uint8_t)~SCL_1_MASK;
+        SDA_1_BYP &= (uint8_t)~SDA_1_MASK;
+        CyExitCriticalSection(interrupt_state);
+
+        SDA_1_Write(1);
+        SCL_1_Write(1);
+        CyDelayUs(I2C_RECOVERY_HALF_PERIOD_US);
+
+        // Clock the slave until it releases SDA, it can be in the middle of a byte
+        for (uint8_t i = 0; i < I2C_RECOVERY_CLOCKS && SDA_1_Read() == 0; i++)
+        {
+            SCL_1_Write(0);
+            CyDelayUs(I2C_RECOVERY_HALF_PERIOD_US);
+            SCL_1_Write(1);
+            CyDelayUs(I2C_RECOVERY_HALF_PERIOD_US);
+        }
+
+        // Stop condition: SDA rising while SCL is high
+        SCL_1_Write(0);
+        CyDelayUs(I2C_RECOVERY_HALF_PERIOD_US);
+        SDA_1_Write(0);
+        CyDelayUs(I2C_RECOVERY_HALF_PERIOD_US);
+        SCL_1_Write(1);
+        CyDelayUs(I2C_RECOVERY_HALF_PERIOD_US);
+        SDA_1_Write(1);
+        CyDelayUs(I2C_RECOVERY_HALF_PERIOD_US);
+
+        uint8_t released = SDA_1_Read();
+
+        // Give the pins back to the I2C block and restart it
+        interrupt_state = CyEnterCriticalSection();
+        SCL_1_BYP |= SCL_1_MASK;
+        SDA_1_BYP |= SDA_1_MASK;
+        CyExitCriticalSection(interrupt_state);
+
+        I2C_Master_Start();
+
+        return released ? NO_ERROR : ERROR;
+    }
+
+/* [] END OF FILE */
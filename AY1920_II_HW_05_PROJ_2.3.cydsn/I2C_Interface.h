@@ -14,8 +14,53 @@
     #define I2C_Interface_H
     
     #include "cytypes.h"
+    #include "I2C_Master.h"
     #include "ErrorCodes.h"
     
+    /**
+    *   \brief Retry policy of the I2C transactions.
+    *
+    *   A transaction that fails is repeated up to max_retries times. Before each
+    *   retry the firmware waits backoff_us microseconds, doubling the wait at
+    *   every new attempt. A transaction that doesn't complete in
+    *   timeout_us_per_byte microseconds for each byte on the bus is aborted and
+    *   followed by a bus recovery sequence, so a stuck slave can't stall the loop.
+    */
+    typedef struct {
+        uint8_t max_retries;            ///< Number of retries after the first failed attempt
+        uint16_t backoff_us;            ///< Wait before the first retry
+        uint16_t timeout_us_per_byte;   ///< Time allowed on the bus for every transferred byte
+    } I2C_RetryPolicy;
+    
+    /**
+    *   \brief Counters of the I2C interface.
+    */
+    typedef struct {
+        uint32_t transactions;  ///< Transactions requested
+        uint32_t nak_errors;    ///< Attempts failed because of a NAK or a bus error
+        uint32_t timeouts;      ///< Attempts aborted because of the timeout
+        uint32_t retries;       ///< Attempts repeated
+        uint32_t recoveries;    ///< Bus recovery sequences performed
+        uint32_t failures;      ///< Transactions failed after all the retries
+    } I2C_Stats;
+    
+    /**
+    *   \brief Default number of retries of a transaction.
+    */
+    #define I2C_DEFAULT_MAX_RETRIES 3
+    
+    /**
+    *   \brief Default wait before the first retry of a transaction, in us.
+    */
+    #define I2C_DEFAULT_BACKOFF_US 100
+    
+    /**
+    *   \brief Default time allowed for every byte of a transaction, in us.
+    *
+    *   Twice the duration of the 9 bit clocks of a byte at the I2C_Master data rate.
+    */
+    #define I2C_DEFAULT_TIMEOUT_US_PER_BYTE (2 * 9000 / I2C_Master_DATA_RATE)
+    
     /** \brief Start the I2C peripheral.
     *   
     *   This function starts the I2C peripheral so that it is ready to work.
@@ -92,5 +137,54 @@
     */
     uint8_t I2C_Peripheral_IsDeviceConnected(uint8_t device_address);
     
+    /** 
+    *   \brief Start reading multiple bytes over I2C without waiting.
+    *   
+    *   This function starts the same operation of I2C_Peripheral_ReadRegisterMulti()
+    *   and returns immediately. The transfer, its retries and its timeout are
+    *   carried on by I2C_Peripheral_Poll(), so the CPU can work on other data
+    *   while the bus is busy. No other function of the interface can be called
+    *   until the transfer is completed.
+    *   \param device_address I2C address of the device to talk to.
+    *   \param register_address Address of the first register to be read.
+    *   \param register_count Number of registers we want to read.
+    *   \param data Pointer to an array where data will be saved.
+    */
+    ErrorCode I2C_Peripheral_StartReadRegisterMulti(uint8_t device_address,
+                                                    uint8_t register_address,
+                                                    uint8_t register_count,
+                                                    uint8_t* data);
+    
+    /**
+    *   \brief Carry on the transfer started without waiting.
+    *
+    *   \param result Pointer to a variable where the result of the transfer
+    *   will be saved once it is completed.
+    *   \retval Returns true (>0) while the transfer is still in progress.
+    */
+    uint8_t I2C_Peripheral_Poll(ErrorCode* result);
+    
+    /**
+    *   \brief Set the retry policy of the I2C transactions.
+    *
+    *   \param policy Pointer to the new policy, its content is copied.
+    */
+    void I2C_Peripheral_SetRetryPolicy(const I2C_RetryPolicy* policy);
+    
+    /**
+    *   \brief Get the counters of the I2C interface.
+    */
+    const I2C_Stats* I2C_Peripheral_GetStats(void);
+    
+    /**
+    *   \brief Free a bus held by a slave.
+    *
+    *   This function stops the I2C peripheral, clocks SCL up to 9 times until
+    *   the slave releases SDA, generates a stop condition and starts the
+    *   peripheral again.
+    *   \retval Returns ERROR if SDA is still held low at the end of the sequence.
+    */
+    ErrorCode I2C_Peripheral_RecoverBus(void);
+    
 #endif // I2C_Interface_H
 /* [] END OF FILE */
@@ -0,0 +1,62 @@
+/*
+* This file includes the source code of the detection
+* of impacts.
+*/
+
+#include "Impact.h"
+#include "FixedMath.h"
+#include "RamCode.h"
+
+void Impact_Init(Impact* impact)
+{
+    impact->index = 0;
+    impact->peak = 0;
+    impact->active = 0;
+}
+
+RAM_CODE uint8_t Impact_Add(Impact* impact, const uint8_t* sample, uint8_t sensitivity,
+                   uint16_t threshold, Impact_Event* event)
+{
+    uint32_t magnitude = 0;     // Squared, in mg^2: at +-16g every axis is below 24576 mg
+    uint8_t ended = 0;
+
+    for (uint8_t axis = 0; axis < 3; axis++)
+    {
+        int32_t value = ((int16)((sample[2*axis] | (sample[2*axis+1]<<8)))>>4) * sensitivity;
+
+        magnitude += (uint32_t)(value * value);
+    }
+
+    uint32_t start_level = (uint32_t)threshold * threshold;
+
+    if (!impact->active)
+    {
+        if (magnitude >= start_level)
+        {
+            impact->active = 1;
+            impact->start = impact->index;
+            impact->peak = magnitude;
+        }
+    }
+    else if (magnitude < start_level / (IMPACT_RELEASE_DEN * IMPACT_RELEASE_DEN) *
+                         (IMPACT_RELEASE_NUM * IMPACT_RELEASE_NUM))
+    {
+        uint32_t duration = impact->index - impact->start;
+
+        event->peak = FixedMath_Sqrt(impact->peak);
+        event->duration = (duration > 0xFFFF) ? 0xFFFF : duration;
+        event->timestamp = impact->start;
+        impact->active = 0;
+        ended = 1;
+    }
+    else if (magnitude > impact->peak)
+    {
+        impact->peak = magnitude;   // Peak hold
+    }
+
+    impact->index++;
+
+    return ended;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,70 @@
+/**
+*   \file Impact.h
+*   \brief Detection of impacts from the magnitude of the acceleration.
+*
+*   The squared magnitude of every sample is compared with the squared
+*   threshold, so no square root is needed while the sensor is quiet. An
+*   impact starts with the first sample above the threshold and ends with
+*   the first one below IMPACT_RELEASE_NUM / IMPACT_RELEASE_DEN of it; the
+*   largest magnitude seen in between is held and converted to mg with the
+*   integer square root only once, when the impact ends.
+*
+*   The magnitude is computed in mg from the digits and the sensitivity,
+*   all the full scale ranges up to +-16g fit the 32 bit squares.
+*
+*   \author Simone Fiorani
+*   \date 2020
+*/
+
+#ifndef __IMPACT_H
+    #define __IMPACT_H
+
+    #include "cytypes.h"
+
+    /**
+    *   \brief Hysteresis of the end of an impact, 3/4 of the threshold.
+    */
+    #define IMPACT_RELEASE_NUM 3
+    #define IMPACT_RELEASE_DEN 4
+
+    /**
+    *   \brief Completed impact.
+    */
+    typedef struct {
+        uint16_t peak;          ///< Largest magnitude, in mg
+        uint16_t duration;      ///< Samples above the threshold, saturated to 65535
+        uint32_t timestamp;     ///< Index of the first sample above the threshold
+    } Impact_Event;
+
+    /**
+    *   \brief State of the detection for a sensor.
+    */
+    typedef struct {
+        uint32_t index;         ///< Samples seen since Impact_Init()
+        uint32_t start;         ///< Index of the first sample of the impact in progress
+        uint32_t peak;          ///< Largest squared magnitude of the impact in progress, in mg^2
+        uint8_t active;         ///< Set while an impact is in progress
+    } Impact;
+
+    /**
+    *   \brief Restart the detection and the count of the samples.
+    *
+    *   \param impact State of the sensor.
+    */
+    void Impact_Init(Impact* impact);
+
+    /**
+    *   \brief Check a sample against the threshold.
+    *
+    *   \param impact State of the sensor.
+    *   \param sample LSB and MSB of the X, Y and Z axis, as read from the sensor.
+    *   \param sensitivity Sensitivity of the sensor in mg/digit.
+    *   \param threshold Magnitude that starts an impact, in mg.
+    *   \param event Impact, written when it ends.
+    *   \return 1 if an impact ended and `event` has been written.
+    */
+    uint8_t Impact_Add(Impact* impact, const uint8_t* sample, uint8_t sensitivity,
+                       uint16_t threshold, Impact_Event* event);
+
+#endif
+/* [] END OF FILE */
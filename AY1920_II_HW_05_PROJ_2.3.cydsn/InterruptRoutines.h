@@ -2,7 +2,6 @@
     
     #include "project.h"
     #include "cytypes.h"
-    #include "stdio.h"
     
     int FlagREAD;   // Declaration of the Flag used in the ISR
     
@@ -0,0 +1,325 @@
+/*
+* This file includes the source code of the LIS3DH driver and
+* of the shadow copy of its writable registers.
+*/
+
+#include "LIS3DH.h"
+#include "I2C_Interface.h"
+#include "RamCode.h"
+
+/**
+*   \brief Writable registers of the shadow range, one bit for each register starting from 0x1F.
+*
+*   0x1F-0x26, 0x2E, 0x30, 0x32-0x34, 0x36-0x38, 0x3A-0x3E. Status, output and
+*   source registers are read only and can't be part of a write burst.
+*/
+#define LIS3DH_SHADOW_WRITABLE_MASK 0xFBBA80FFu
+
+/**
+*   \brief Bit of the shadow masks corresponding to a register.
+*/
+#define LIS3DH_SHADOW_BIT(index) ((uint32_t)1u << (index))
+
+ErrorCode LIS3DH_Init(LIS3DH_Handle* dev, uint8_t address, uint8_t channel)
+{
+    dev->address = address;
+    dev->channel = channel;
+    dev->fifo_src = LIS3DH_FIFO_SRC_EMPTY;
+
+    // With FIFO_EN left set by a warm reset the auto-increment wraps from the
+    // last output register back to the first one, so the shadow is read in
+    // two bursts around the outputs, which are never cached
+    uint8_t outputs = LIS3DH_X_AXIS_L - LIS3DH_SHADOW_FIRST_REG;
+    uint8_t after_outputs = LIS3DH_FIFO_CTRL_REG - LIS3DH_SHADOW_FIRST_REG;
+
+    for (uint8_t i = outputs; i < after_outputs; i++)
+    {
+        dev->shadow[i] = 0;
+    }
+
+    ErrorCode error = I2C_Peripheral_ReadRegisterMulti(dev->address,
+                                                       LIS3DH_SHADOW_FIRST_REG,
+                                                       outputs,
+                                                       dev->shadow);
+    if (error == NO_ERROR)
+    {
+        error = I2C_Peripheral_ReadRegisterMulti(dev->address,
+                                                 LIS3DH_FIFO_CTRL_REG,
+                                                 LIS3DH_SHADOW_SIZE - after_outputs,
+                                                 &dev->shadow[after_outputs]);
+    }
+
+    // The reboot bit clears itself on the device, so it must never be written back
+    dev->shadow[LIS3DH_CTRL_REG5 - LIS3DH_SHADOW_FIRST_REG] &= ~LIS3DH_CTRL_REG5_BOOT;
+    dev->dirty = 0;
+
+    return error;
+}
+
+uint8_t LIS3DH_GetRegister(const LIS3DH_Handle* dev, uint8_t register_address)
+{
+    return dev->shadow[register_address - LIS3DH_SHADOW_FIRST_REG];
+}
+
+void LIS3DH_SetRegister(LIS3DH_Handle* dev, uint8_t register_address, uint8_t value)
+{
+    uint8_t index = register_address - LIS3DH_SHADOW_FIRST_REG;
+
+    if (dev->shadow[index] != value)
+    {
+        dev->shadow[index] = value;
+        dev->dirty |= LIS3DH_SHADOW_BIT(index);
+    }
+}
+
+void LIS3DH_UpdateBits(LIS3DH_Handle* dev, uint8_t register_address, uint8_t mask, uint8_t value)
+{
+    uint8_t current = LIS3DH_GetRegister(dev, register_address);
+
+    LIS3DH_SetRegister(dev, register_address, (current & ~mask) | (value & mask));
+}
+
+uint8_t LIS3DH_IsDirty(const LIS3DH_Handle* dev)
+{
+    return dev->dirty != 0;
+}
+
+ErrorCode LIS3DH_Commit(LIS3DH_Handle* dev)
+{
+    uint8_t first = 0;
+
+    while (dev->dirty != 0)
+    {
+        // Look for the first dirty register
+        while ((dev->dirty & LIS3DH_SHADOW_BIT(first)) == 0)
+        {
+            first++;
+        }
+
+        // Extend the burst up to the last dirty register reachable through writable registers
+        uint8_t last = first;
+        for (uint8_t i = first + 1; i < LIS3DH_SHADOW_SIZE; i++)
+        {
+            if ((LIS3DH_SHADOW_WRITABLE_MASK & LIS3DH_SHADOW_BIT(i)) == 0)
+            {
+                break;
+            }
+            if (dev->dirty & LIS3DH_SHADOW_BIT(i))
+            {
+                last = i;
+            }
+        }
+
+        ErrorCode error = I2C_Peripheral_WriteRegisterMulti(dev->address,
+                                                            LIS3DH_SHADOW_FIRST_REG + first,
+                                                            last - first + 1,
+                                                            &dev->shadow[first]);
+        if (error != NO_ERROR)
+        {
+            // Registers stay dirty, so the next commit will try again
+            return error;
+        }
+
+        for (uint8_t i = first; i <= last; i++)
+        {
+            dev->dirty &= ~LIS3DH_SHADOW_BIT(i);
+        }
+        first = last + 1;
+    }
+
+    // The reboot request has been sent, the device clears the bit by itself
+    dev->shadow[LIS3DH_CTRL_REG5 - LIS3DH_SHADOW_FIRST_REG] &= ~LIS3DH_CTRL_REG5_BOOT;
+
+    return NO_ERROR;
+}
+
+void LIS3DH_SetDataRate(LIS3DH_Handle* dev, uint8_t odr)
+{
+    LIS3DH_UpdateBits(dev, LIS3DH_CTRL_REG1, LIS3DH_CTRL_REG1_ODR_MASK, odr);
+}
+
+void LIS3DH_SetFullScale(LIS3DH_Handle* dev, uint8_t fs)
+{
+    LIS3DH_UpdateBits(dev, LIS3DH_CTRL_REG4, LIS3DH_CTRL_REG4_FS_MASK, fs);
+}
+
+uint16_t LIS3DH_GetDataRateHz(const LIS3DH_Handle* dev)
+{
+    // Hz for the ODR codes from 0x00 to 0x90, the last two depend on the low power mode
+    static const uint16_t rate[10] = { 0, 1, 10, 25, 50, 100, 200, 400, 1600, 1344 };
+
+    uint8_t ctrl1 = LIS3DH_GetRegister(dev, LIS3DH_CTRL_REG1);
+    uint8_t code = (ctrl1 & LIS3DH_CTRL_REG1_ODR_MASK) >> 4;
+
+    if (code >= 10)
+    {
+        return 0;   // Reserved codes
+    }
+    if (code == 9 && (ctrl1 & LIS3DH_CTRL_REG1_LPEN))
+    {
+        return 5376;
+    }
+
+    return rate[code];
+}
+
+uint8_t LIS3DH_GetSensitivity(const LIS3DH_Handle* dev)
+{
+    // mg/digit of the 12 bit outputs for +-2g, +-4g, +-8g and +-16g
+    static const uint8_t sensitivity[4] = { 1, 2, 4, 12 };
+
+    return sensitivity[(LIS3DH_GetRegister(dev, LIS3DH_CTRL_REG4) & LIS3DH_CTRL_REG4_FS_MASK) >> 4];
+}
+
+void LIS3DH_SetFifoMode(LIS3DH_Handle* dev, uint8_t mode)
+{
+    LIS3DH_UpdateBits(dev, LIS3DH_FIFO_CTRL_REG, LIS3DH_FIFO_CTRL_FM_MASK, mode);
+    LIS3DH_UpdateBits(dev, LIS3DH_CTRL_REG5, LIS3DH_CTRL_REG5_FIFO_EN,
+                      (mode == LIS3DH_FIFO_MODE_BYPASS) ? 0 : LIS3DH_CTRL_REG5_FIFO_EN);
+}
+
+ErrorCode LIS3DH_RestartFifo(LIS3DH_Handle* dev, uint8_t mode)
+{
+    LIS3DH_SetFifoMode(dev, LIS3DH_FIFO_MODE_BYPASS);
+
+    ErrorCode error = LIS3DH_Commit(dev);
+
+    LIS3DH_SetFifoMode(dev, mode);
+
+    return (error == NO_ERROR) ? LIS3DH_Commit(dev) : error;
+}
+
+void LIS3DH_SetLowPower(LIS3DH_Handle* dev, uint8_t enable)
+{
+    // LPEN and HR together are not allowed
+    LIS3DH_UpdateBits(dev, LIS3DH_CTRL_REG1, LIS3DH_CTRL_REG1_LPEN, enable ? LIS3DH_CTRL_REG1_LPEN : 0);
+    LIS3DH_UpdateBits(dev, LIS3DH_CTRL_REG4, LIS3DH_CTRL_REG4_HR, enable ? 0 : LIS3DH_CTRL_REG4_HR);
+}
+
+uint8_t LIS3DH_IsLowPower(const LIS3DH_Handle* dev)
+{
+    return (LIS3DH_GetRegister(dev, LIS3DH_CTRL_REG1) & LIS3DH_CTRL_REG1_LPEN) != 0;
+}
+
+RAM_CODE void LIS3DH_PackSample(const uint8_t* sample, uint8_t* packed)
+{
+    // Forward copy, every MSB is read before its position can be overwritten
+    for (uint8_t axis = 0; axis < 3; axis++)
+    {
+        packed[axis] = sample[2*axis+1];
+    }
+}
+
+void LIS3DH_EnableAux(LIS3DH_Handle* dev, uint8_t temperature)
+{
+    LIS3DH_SetRegister(dev, LIS3DH_TEMP_CFG_REG,
+                       LIS3DH_TEMP_CFG_ADC_EN | (temperature ? LIS3DH_TEMP_CFG_TEMP_EN : 0));
+}
+
+void LIS3DH_SetActivity(LIS3DH_Handle* dev, uint8_t threshold, uint8_t duration)
+{
+    uint8_t enable = (threshold != 0);
+
+    LIS3DH_SetRegister(dev, LIS3DH_INT1_THS, threshold & LIS3DH_INT1_THS_MASK);
+    LIS3DH_SetRegister(dev, LIS3DH_INT1_DURATION, duration & LIS3DH_INT1_DURATION_MASK);
+    LIS3DH_SetRegister(dev, LIS3DH_INT1_CFG, enable ?
+                       (LIS3DH_INT1_CFG_XHIE | LIS3DH_INT1_CFG_YHIE | LIS3DH_INT1_CFG_ZHIE) : 0);
+
+    // Gravity is removed by the high pass filter, the event is latched so a slow poll can't miss it
+    LIS3DH_UpdateBits(dev, LIS3DH_CTRL_REG2, LIS3DH_CTRL_REG2_HP_IA1, enable ? LIS3DH_CTRL_REG2_HP_IA1 : 0);
+    LIS3DH_UpdateBits(dev, LIS3DH_CTRL_REG3, LIS3DH_CTRL_REG3_I1_IA1, enable ? LIS3DH_CTRL_REG3_I1_IA1 : 0);
+    LIS3DH_UpdateBits(dev, LIS3DH_CTRL_REG5, LIS3DH_CTRL_REG5_LIR_INT1, enable ? LIS3DH_CTRL_REG5_LIR_INT1 : 0);
+}
+
+ErrorCode LIS3DH_ReadActivity(LIS3DH_Handle* dev, uint8_t* active)
+{
+    uint8_t int1_src;
+
+    ErrorCode error = I2C_Peripheral_ReadRegister(dev->address, LIS3DH_INT1_SRC, &int1_src);
+
+    *active = (error == NO_ERROR) && (int1_src & LIS3DH_INT1_SRC_IA);
+
+    return error;
+}
+
+ErrorCode LIS3DH_ReadAux(LIS3DH_Handle* dev, int16_t* adc)
+{
+    uint8_t AuxData[2 * LIS3DH_AUX_CHANNELS];
+
+    ErrorCode error = I2C_Peripheral_ReadRegisterMulti(dev->address,
+                                                       LIS3DH_OUT_ADC_1L,
+                                                       2 * LIS3DH_AUX_CHANNELS,
+                                                       AuxData);
+    if (error == NO_ERROR)
+    {
+        for (uint8_t i = 0; i < LIS3DH_AUX_CHANNELS; i++)
+        {
+            // The 10 bit values are left aligned
+            adc[i] = (int16)((AuxData[2*i] | (AuxData[2*i+1]<<8)))>>6;
+        }
+    }
+
+    return error;
+}
+
+ErrorCode LIS3DH_ReadFifo(LIS3DH_Handle* dev,
+                          uint8_t* data,
+                          uint8_t max_samples,
+                          uint8_t* sample_count)
+{
+    *sample_count = 0;
+
+    ErrorCode error = I2C_Peripheral_ReadRegister(dev->address,
+                                                  LIS3DH_FIFO_SRC_REG,
+                                                  &dev->fifo_src);
+    if (error != NO_ERROR)
+    {
+        return error;
+    }
+
+    uint8_t available = LIS3DH_GetFifoLevel(dev);
+    if (available > max_samples)
+    {
+        available = max_samples;
+    }
+    if (available == 0)
+    {
+        return NO_ERROR;
+    }
+
+    // In FIFO mode the auto-increment wraps from OUT_Z_H back to OUT_X_L,
+    // so all the samples are read in a single burst
+    error = I2C_Peripheral_ReadRegisterMulti(dev->address,
+                                             LIS3DH_X_AXIS_L,
+                                             available * LIS3DH_SAMPLE_SIZE,
+                                             data);
+    if (error == NO_ERROR)
+    {
+        *sample_count = available;
+    }
+
+    return error;
+}
+
+ErrorCode LIS3DH_StartReadFifoStatus(LIS3DH_Handle* dev)
+{
+    return I2C_Peripheral_StartReadRegisterMulti(dev->address, LIS3DH_FIFO_SRC_REG, 1, &dev->fifo_src);
+}
+
+uint8_t LIS3DH_GetFifoLevel(const LIS3DH_Handle* dev)
+{
+    // FSS counts up to 31, a full FIFO is signalled by the overrun flag
+    return (dev->fifo_src & LIS3DH_FIFO_SRC_OVRN) ?
+           LIS3DH_FIFO_SIZE : (dev->fifo_src & LIS3DH_FIFO_SRC_FSS_MASK);
+}
+
+ErrorCode LIS3DH_StartReadFifoData(LIS3DH_Handle* dev, uint8_t* data, uint8_t sample_count)
+{
+    // The auto-increment wraps from OUT_Z_H back to OUT_X_L, one burst for all the samples
+    return I2C_Peripheral_StartReadRegisterMulti(dev->address,
+                                                 LIS3DH_X_AXIS_L,
+                                                 sample_count * LIS3DH_SAMPLE_SIZE,
+                                                 data);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,403 @@
+/**
+*   \file LIS3DH.h
+*   \brief LIS3DH accelerometer driver.
+*
+*   Register map of the LIS3DH and handle based driver. Every device on the
+*   bus is described by a LIS3DH_Handle that holds its address, the channel
+*   ID used in the output frames and a shadow copy of its writable registers.
+*   The configuration is changed on the shadow (no bus traffic) and the
+*   registers marked as dirty are sent to the device with LIS3DH_Commit(),
+*   grouping the neighbouring ones in a single auto-increment burst.
+*
+*   \author Simone Fiorani
+*   \date 2020
+*/
+
+#ifndef __LIS3DH_H
+    #define __LIS3DH_H
+
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+
+    /**
+    *   \brief 7-bit I2C address of the slave device with SA0 connected to ground.
+    */
+    #define LIS3DH_DEVICE_ADDRESS 0x18
+    
+    /**
+    *   \brief 7-bit I2C address of the slave device with SA0 connected to supply voltage.
+    */
+    #define LIS3DH_DEVICE_ADDRESS_SA0 0x19
+    
+    /**
+    *   \brief Maximum number of devices on the same bus (one for each SA0 level).
+    */
+    #define LIS3DH_MAX_DEVICES 2
+
+    /******************************************/
+    /*             Register map               */
+    /******************************************/
+
+    #define LIS3DH_STATUS_REG_AUX 0x07      ///< Status of the auxiliary ADC and temperature sensor
+    #define LIS3DH_OUT_ADC_1L 0x08          ///< First register of the auxiliary ADC outputs
+    #define LIS3DH_OUT_ADC_3L 0x0C          ///< ADC 3 / temperature output LSB
+    #define LIS3DH_OUT_ADC_3H 0x0D          ///< ADC 3 / temperature output MSB
+    #define LIS3DH_WHO_AM_I_REG_ADDR 0x0F   ///< WHO AM I register
+    #define LIS3DH_TEMP_CFG_REG 0x1F        ///< Temperature sensor configuration register
+    #define LIS3DH_CTRL_REG1 0x20           ///< Control register 1
+    #define LIS3DH_CTRL_REG2 0x21           ///< Control register 2
+    #define LIS3DH_CTRL_REG3 0x22           ///< Control register 3
+    #define LIS3DH_CTRL_REG4 0x23           ///< Control register 4
+    #define LIS3DH_CTRL_REG5 0x24           ///< Control register 5
+    #define LIS3DH_CTRL_REG6 0x25           ///< Control register 6
+    #define LIS3DH_REFERENCE 0x26           ///< Reference register of the interrupt generators
+    #define LIS3DH_STATUS_REG 0x27          ///< Status register
+    #define LIS3DH_X_AXIS_L 0x28            ///< X axis output LSB, first register of the multiread
+    #define LIS3DH_FIFO_CTRL_REG 0x2E       ///< FIFO control register
+    #define LIS3DH_FIFO_SRC_REG 0x2F        ///< FIFO source register
+    #define LIS3DH_INT1_CFG 0x30            ///< Interrupt 1 configuration register
+    #define LIS3DH_INT1_SRC 0x31            ///< Interrupt 1 source register
+    #define LIS3DH_INT1_THS 0x32            ///< Interrupt 1 threshold register
+    #define LIS3DH_INT1_DURATION 0x33       ///< Interrupt 1 duration register
+
+    /**
+    *   \brief Expected content of the WHO AM I register.
+    */
+    #define LIS3DH_WHO_AM_I_VALUE 0x33
+
+    /******************************************/
+    /*            Register fields             */
+    /******************************************/
+
+    #define LIS3DH_STATUS_REG_ZYXDA 0x08    ///< New X, Y and Z data available
+    #define LIS3DH_STATUS_REG_ZYXOR 0x80    ///< X, Y and Z data overrun
+
+    #define LIS3DH_TEMP_CFG_ADC_EN 0x80     ///< Auxiliary ADC enable
+    #define LIS3DH_TEMP_CFG_TEMP_EN 0x40    ///< Temperature sensor enable
+
+    #define LIS3DH_CTRL_REG1_ODR_MASK 0xF0  ///< Output data rate selection
+    #define LIS3DH_CTRL_REG1_LPEN 0x08      ///< Low power mode enable
+    #define LIS3DH_CTRL_REG1_XYZ_EN 0x07    ///< X, Y and Z axis enable
+
+    #define LIS3DH_ODR_POWER_DOWN 0x00      ///< Power down mode
+    #define LIS3DH_ODR_1HZ 0x10             ///< 1 Hz
+    #define LIS3DH_ODR_10HZ 0x20            ///< 10 Hz
+    #define LIS3DH_ODR_25HZ 0x30            ///< 25 Hz
+    #define LIS3DH_ODR_50HZ 0x40            ///< 50 Hz
+    #define LIS3DH_ODR_100HZ 0x50           ///< 100 Hz
+    #define LIS3DH_ODR_200HZ 0x60           ///< 200 Hz
+    #define LIS3DH_ODR_400HZ 0x70           ///< 400 Hz
+    #define LIS3DH_ODR_1600HZ_LP 0x80       ///< 1.6 kHz (low power mode only)
+    #define LIS3DH_ODR_1344HZ 0x90          ///< 1.344 kHz (normal and high resolution mode)
+    #define LIS3DH_ODR_5376HZ_LP 0x90       ///< 5.376 kHz (low power mode)
+
+    #define LIS3DH_CTRL_REG2_HP_IA1 0x01    ///< High pass filter on the interrupt generator 1
+
+    #define LIS3DH_CTRL_REG3_I1_IA1 0x40    ///< Interrupt generator 1 routed to the INT1 pin
+
+    #define LIS3DH_CTRL_REG4_BDU 0x80       ///< Block data update
+    #define LIS3DH_CTRL_REG4_FS_MASK 0x30   ///< Full scale selection
+    #define LIS3DH_CTRL_REG4_HR 0x08        ///< High resolution output mode
+    #define LIS3DH_CTRL_REG4_ST_MASK 0x06   ///< Self test selection
+
+    #define LIS3DH_FS_2G 0x00               ///< +-2g full scale range
+    #define LIS3DH_FS_4G 0x10               ///< +-4g full scale range
+    #define LIS3DH_FS_8G 0x20               ///< +-8g full scale range
+    #define LIS3DH_FS_16G 0x30              ///< +-16g full scale range
+
+    #define LIS3DH_ST_NORMAL 0x00           ///< Self test disabled
+    #define LIS3DH_ST_0 0x02                ///< Self test 0, positive force on the mass
+    #define LIS3DH_ST_1 0x04                ///< Self test 1, negative force on the mass
+
+    #define LIS3DH_CTRL_REG5_BOOT 0x80      ///< Reboot memory content (self clearing)
+    #define LIS3DH_CTRL_REG5_FIFO_EN 0x40   ///< FIFO enable
+    #define LIS3DH_CTRL_REG5_LIR_INT1 0x08  ///< Interrupt 1 latched until INT1_SRC is read
+
+    #define LIS3DH_FIFO_CTRL_FM_MASK 0xC0   ///< FIFO mode selection
+    #define LIS3DH_FIFO_CTRL_TR 0x20        ///< Trigger of the Stream-to-FIFO mode on INT2 instead of INT1
+    #define LIS3DH_FIFO_CTRL_FTH_MASK 0x1F  ///< FIFO watermark level
+    #define LIS3DH_FIFO_MODE_BYPASS 0x00    ///< FIFO bypassed
+    #define LIS3DH_FIFO_MODE_FIFO 0x40      ///< FIFO stops collecting when full
+    #define LIS3DH_FIFO_MODE_STREAM 0x80    ///< FIFO discards the oldest sample when full
+    #define LIS3DH_FIFO_MODE_STREAM_TO_FIFO 0xC0    ///< Stream mode until the trigger, then FIFO mode
+
+    #define LIS3DH_FIFO_SRC_WTM 0x80        ///< FIFO content above the watermark level
+    #define LIS3DH_FIFO_SRC_OVRN 0x40       ///< FIFO full, oldest samples overwritten
+    #define LIS3DH_FIFO_SRC_EMPTY 0x20      ///< FIFO empty
+    #define LIS3DH_FIFO_SRC_FSS_MASK 0x1F   ///< Number of unread samples in the FIFO
+
+    #define LIS3DH_INT1_CFG_AOI 0x80        ///< AND combination of the events instead of OR
+    #define LIS3DH_INT1_CFG_ZHIE 0x20       ///< Event on Z above the threshold
+    #define LIS3DH_INT1_CFG_YHIE 0x08       ///< Event on Y above the threshold
+    #define LIS3DH_INT1_CFG_XHIE 0x02       ///< Event on X above the threshold
+
+    #define LIS3DH_INT1_SRC_IA 0x40         ///< One or more events have been generated
+
+    #define LIS3DH_INT1_THS_MASK 0x7F       ///< Threshold, 16/32/62/186 mg per LSB at +-2/4/8/16g
+    #define LIS3DH_INT1_DURATION_MASK 0x7F  ///< Minimum duration of the event, in samples
+
+    /**
+    *   \brief Number of samples stored by the FIFO.
+    */
+    #define LIS3DH_FIFO_SIZE 32
+
+    /**
+    *   \brief Bytes of one X, Y, Z sample (LSB and MSB of each axis).
+    */
+    #define LIS3DH_SAMPLE_SIZE 6
+
+    /**
+    *   \brief Bytes of one X, Y, Z sample packed to 8 bit, see LIS3DH_PackSample().
+    */
+    #define LIS3DH_PACKED_SAMPLE_SIZE 3
+
+    /**
+    *   \brief Number of channels of the auxiliary ADC.
+    */
+    #define LIS3DH_AUX_CHANNELS 3
+
+    /**
+    *   \brief MSB of the sub-address that enables the register auto-increment.
+    */
+    #define LIS3DH_AUTO_INCREMENT 0x80
+
+    /******************************************/
+    /*             Register shadow            */
+    /******************************************/
+
+    /**
+    *   \brief First register kept in the shadow copy.
+    */
+    #define LIS3DH_SHADOW_FIRST_REG LIS3DH_TEMP_CFG_REG
+
+    /**
+    *   \brief Number of consecutive registers kept in the shadow copy (0x1F to 0x3E).
+    */
+    #define LIS3DH_SHADOW_SIZE 32
+
+    /**
+    *   \brief State of a LIS3DH device.
+    */
+    typedef struct {
+        uint8_t address;                        ///< 7-bit I2C address
+        uint8_t channel;                        ///< Channel ID of the device in the output frames
+        uint8_t fifo_src;                       ///< Content of FIFO_SRC_REG at the last FIFO read
+        uint8_t shadow[LIS3DH_SHADOW_SIZE];     ///< Cached content of the registers from 0x1F to 0x3E
+        uint32_t dirty;                         ///< Registers changed in the shadow but not written yet
+    } LIS3DH_Handle;
+
+    /**
+    *   \brief Initialize the register shadow.
+    *
+    *   This function binds the handle to a device and fills the shadow with the
+    *   current content of the device registers through two burst reads, one on
+    *   each side of the output registers.
+    *   \param dev Handle of the device.
+    *   \param address 7-bit I2C address of the device.
+    *   \param channel Channel ID of the device in the output frames.
+    */
+    ErrorCode LIS3DH_Init(LIS3DH_Handle* dev, uint8_t address, uint8_t channel);
+
+    /**
+    *   \brief Get the cached value of a register.
+    *
+    *   No bus transaction is performed.
+    *   \param dev Handle of the device.
+    *   \param register_address Address of the register, it must be inside the shadow range.
+    */
+    uint8_t LIS3DH_GetRegister(const LIS3DH_Handle* dev, uint8_t register_address);
+
+    /**
+    *   \brief Set the value of a register in the shadow.
+    *
+    *   The register is marked as dirty only if the new value differs from the
+    *   cached one. Nothing is written on the bus until LIS3DH_Commit() is called.
+    *   \param dev Handle of the device.
+    *   \param register_address Address of the register, it must be writable.
+    *   \param value New content of the register.
+    */
+    void LIS3DH_SetRegister(LIS3DH_Handle* dev, uint8_t register_address, uint8_t value);
+
+    /**
+    *   \brief Read-modify-write of some bits of a register in the shadow.
+    *
+    *   The read half is served by the shadow, so no bus transaction is performed.
+    *   \param dev Handle of the device.
+    *   \param register_address Address of the register, it must be writable.
+    *   \param mask Bits of the register to be modified.
+    *   \param value New value of the masked bits.
+    */
+    void LIS3DH_UpdateBits(LIS3DH_Handle* dev, uint8_t register_address, uint8_t mask, uint8_t value);
+
+    /**
+    *   \brief Check if some register of the shadow still has to be written.
+    *   \param dev Handle of the device.
+    *   \retval Returns true (>0) if at least one register is dirty.
+    */
+    uint8_t LIS3DH_IsDirty(const LIS3DH_Handle* dev);
+
+    /**
+    *   \brief Write the dirty registers to the device.
+    *
+    *   Neighbouring dirty registers are sent in the same auto-increment burst,
+    *   together with the clean writable registers in between, so that a group
+    *   of changes usually costs a single transaction.
+    *   \param dev Handle of the device.
+    */
+    ErrorCode LIS3DH_Commit(LIS3DH_Handle* dev);
+
+    /**
+    *   \brief Select the output data rate in the shadow.
+    *   \param dev Handle of the device.
+    *   \param odr One of the LIS3DH_ODR_xxx values.
+    */
+    void LIS3DH_SetDataRate(LIS3DH_Handle* dev, uint8_t odr);
+
+    /**
+    *   \brief Select the full scale range in the shadow.
+    *   \param dev Handle of the device.
+    *   \param fs One of the LIS3DH_FS_xxx values.
+    */
+    void LIS3DH_SetFullScale(LIS3DH_Handle* dev, uint8_t fs);
+
+    /**
+    *   \brief Output data rate of the current configuration, in Hz.
+    *
+    *   \param dev Handle of the device.
+    */
+    uint16_t LIS3DH_GetDataRateHz(const LIS3DH_Handle* dev);
+
+    /**
+    *   \brief Sensitivity of the current full scale range, in mg/digit.
+    *
+    *   The value refers to the outputs right aligned to 12 bit, which is the
+    *   same in high resolution, normal and low power mode.
+    *   \param dev Handle of the device.
+    */
+    uint8_t LIS3DH_GetSensitivity(const LIS3DH_Handle* dev);
+
+    /**
+    *   \brief Select the FIFO mode in the shadow.
+    *
+    *   The FIFO is enabled in CTRL_REG5 for every mode but bypass.
+    *   \param dev Handle of the device.
+    *   \param mode One of the LIS3DH_FIFO_MODE_xxx values.
+    */
+    void LIS3DH_SetFifoMode(LIS3DH_Handle* dev, uint8_t mode);
+
+    /**
+    *   \brief Empty the FIFO and restart it in a mode.
+    *
+    *   The content of the FIFO is only cleared going through the bypass
+    *   mode, so two commits are done on the bus.
+    *   \param dev Handle of the device.
+    *   \param mode One of the LIS3DH_FIFO_MODE_xxx values.
+    */
+    ErrorCode LIS3DH_RestartFifo(LIS3DH_Handle* dev, uint8_t mode);
+
+    /**
+    *   \brief Select the low power (8 bit) or the high resolution (12 bit) mode in the shadow.
+    *
+    *   \param dev Handle of the device.
+    *   \param enable If true (>0) low power mode, otherwise high resolution mode.
+    */
+    void LIS3DH_SetLowPower(LIS3DH_Handle* dev, uint8_t enable);
+
+    /**
+    *   \brief Check if the low power (8 bit) mode is selected in the shadow.
+    *   \param dev Handle of the device.
+    */
+    uint8_t LIS3DH_IsLowPower(const LIS3DH_Handle* dev);
+
+    /**
+    *   \brief Pack a sample to 8 bit per axis.
+    *
+    *   In low power mode the outputs are 8 bit left aligned: OUT_x_H holds
+    *   the whole value and OUT_x_L nothing of use, so only the MSBs are kept.
+    *   In the other modes the LSBs below 8 bit are dropped.
+    *   \param sample LSB and MSB of the X, Y and Z axis, as read from the FIFO.
+    *   \param packed MSB of the X, Y and Z axis, it can overlap the beginning of the sample.
+    */
+    void LIS3DH_PackSample(const uint8_t* sample, uint8_t* packed);
+
+    /**
+    *   \brief Enable the auxiliary ADC in the shadow.
+    *
+    *   \param dev Handle of the device.
+    *   \param temperature If true (>0) the third ADC channel measures the temperature sensor.
+    */
+    void LIS3DH_EnableAux(LIS3DH_Handle* dev, uint8_t temperature);
+
+    /**
+    *   \brief Configure the interrupt generator 1 to detect activity in the shadow.
+    *
+    *   An event is generated when any axis, high pass filtered to remove
+    *   gravity, stays above the threshold for the given duration. The event
+    *   is latched until LIS3DH_ReadActivity() reads INT1_SRC.
+    *   \param dev Handle of the device.
+    *   \param threshold Threshold in LSB of INT1_THS, 0 to disable the detection.
+    *   \param duration Minimum duration of the event, in samples.
+    */
+    void LIS3DH_SetActivity(LIS3DH_Handle* dev, uint8_t threshold, uint8_t duration);
+
+    /**
+    *   \brief Read and clear the latched activity event.
+    *
+    *   \param dev Handle of the device.
+    *   \param active Set to 1 if an event has been generated since the last read.
+    */
+    ErrorCode LIS3DH_ReadActivity(LIS3DH_Handle* dev, uint8_t* active);
+
+    /**
+    *   \brief Read the three channels of the auxiliary ADC.
+    *
+    *   The six output registers are read in a single burst and right aligned
+    *   to 10 bit signed values.
+    *   \param dev Handle of the device.
+    *   \param adc Array of 3 values: ADC1, ADC2 and ADC3 (or temperature).
+    */
+    ErrorCode LIS3DH_ReadAux(LIS3DH_Handle* dev, int16_t* adc);
+
+    /**
+    *   \brief Drain the samples stored in the FIFO.
+    *
+    *   This function reads FIFO_SRC_REG to know how many samples are ready and
+    *   reads up to max_samples of them in a single burst starting from
+    *   OUT_X_L. FIFO_SRC_REG is kept in the handle for the overrun check.
+    *   \param dev Handle of the device.
+    *   \param data Array of max_samples * LIS3DH_SAMPLE_SIZE bytes, X, Y, Z order.
+    *   \param max_samples Maximum number of samples to be read.
+    *   \param sample_count Pointer to a variable where the number of read samples will be saved.
+    */
+    ErrorCode LIS3DH_ReadFifo(LIS3DH_Handle* dev,
+                              uint8_t* data,
+                              uint8_t max_samples,
+                              uint8_t* sample_count);
+
+    /**
+    *   \brief Start reading FIFO_SRC_REG without waiting.
+    *
+    *   The transfer is completed by I2C_Peripheral_Poll(), then the register
+    *   is available in the handle and LIS3DH_GetFifoLevel() can be used.
+    *   \param dev Handle of the device.
+    */
+    ErrorCode LIS3DH_StartReadFifoStatus(LIS3DH_Handle* dev);
+
+    /**
+    *   \brief Number of samples in the FIFO at the last read of FIFO_SRC_REG.
+    *   \param dev Handle of the device.
+    */
+    uint8_t LIS3DH_GetFifoLevel(const LIS3DH_Handle* dev);
+
+    /**
+    *   \brief Start draining samples from the FIFO without waiting.
+    *
+    *   The transfer is completed by I2C_Peripheral_Poll().
+    *   \param dev Handle of the device.
+    *   \param data Array of sample_count * LIS3DH_SAMPLE_SIZE bytes, X, Y, Z order.
+    *   \param sample_count Number of samples to be read, not more than LIS3DH_GetFifoLevel().
+    */
+    ErrorCode LIS3DH_StartReadFifoData(LIS3DH_Handle* dev, uint8_t* data, uint8_t sample_count);
+
+#endif
+/* [] END OF FILE */
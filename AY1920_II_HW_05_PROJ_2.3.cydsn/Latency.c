@@ -0,0 +1,140 @@
+/*
+* This file includes the source code of the priority plan
+* of the interrupts and of the measurement of their latency.
+*/
+
+#include "Latency.h"
+#include "core_cm3_psoc5.h"
+#include "I2C_Master.h"
+#include "Timing.h"
+#include "UART_Debug.h"
+
+static volatile uint32_t worst_delay[LATENCY_SOURCES];  // Longest entry delay of every source
+static volatile uint32_t worst_isr;                     // Longest run of the I2C ISR
+
+#if LATENCY_MEASURE
+
+static const uint8_t priorities[LATENCY_SOURCES] = {
+    LATENCY_PRIORITY_I2C, LATENCY_PRIORITY_UART, LATENCY_PRIORITY_INT1, LATENCY_PRIORITY_TIMER
+};
+
+static volatile uint32_t probe_stamp;   // Cycle counter when the probe was pended
+static volatile uint8_t probe_source;   // Source whose priority the probe has
+static volatile uint8_t probe_pending;  // Set until the probe handler runs
+static uint32_t isr_start;              // Cycle counter at the entry of the I2C ISR
+
+/**
+*   \brief Handler of the probe, the delay from the pend is the one of its source.
+*/
+static CY_ISR(Latency_Probe)
+{
+    uint32_t delay = Timing_Elapsed(probe_stamp);
+
+    if (delay > worst_delay[probe_source])
+    {
+        worst_delay[probe_source] = delay;
+    }
+    probe_pending = 0;
+}
+
+/**
+*   \brief Pend the probe with the priority of the next source, if it's not pending yet.
+*/
+static void Latency_Pend(void)
+{
+    uint8_t interrupt_state = CyEnterCriticalSection();
+
+    if (!probe_pending)
+    {
+        probe_source = (probe_source + 1) % LATENCY_SOURCES;
+        CyIntSetPriority(LATENCY_PROBE_IRQ, priorities[probe_source]);
+        probe_pending = 1;
+
+        // The probe runs when the critical section ends, at the earliest
+        probe_stamp = Timing_Now();
+        CyIntSetPending(LATENCY_PROBE_IRQ);
+    }
+
+    CyExitCriticalSection(interrupt_state);
+}
+
+void I2C_Master_ISR_EntryCallback(void)
+{
+    isr_start = Timing_Now();
+
+    // The lower levels wait for the whole ISR
+    Latency_Pend();
+}
+
+void I2C_Master_ISR_ExitCallback(void)
+{
+    uint32_t cycles = Timing_Elapsed(isr_start);
+
+    if (cycles > worst_isr)
+    {
+        worst_isr = cycles;
+    }
+}
+
+#endif
+
+void Latency_Start(void)
+{
+    CyIntSetPriority(I2C_Master_ISR_NUMBER, LATENCY_PRIORITY_I2C);
+    NVIC_SetPriority(SysTick_IRQn, LATENCY_PRIORITY_UART);     // Reception ring of Stream.h
+
+    #if UART_Debug_RX_INTERRUPT_ENABLED
+        CyIntSetPriority(UART_Debug_RX_VECT_NUM, LATENCY_PRIORITY_UART);
+    #endif
+    #if UART_Debug_TX_INTERRUPT_ENABLED
+        CyIntSetPriority(UART_Debug_TX_VECT_NUM, LATENCY_PRIORITY_UART);
+    #endif
+    #ifdef isr_INT1__INTC_NUMBER
+        CyIntSetPriority(isr_INT1__INTC_NUMBER, LATENCY_PRIORITY_INT1);
+    #endif
+    #ifdef isr_READ__INTC_NUMBER
+        CyIntSetPriority(isr_READ__INTC_NUMBER, LATENCY_PRIORITY_TIMER);
+    #endif
+
+    #if LATENCY_MEASURE
+        CyIntSetVector(LATENCY_PROBE_IRQ, &Latency_Probe);
+        CyIntEnable(LATENCY_PROBE_IRQ);
+    #endif
+
+    Latency_Reset();
+}
+
+void Latency_Task(void)
+{
+    #if LATENCY_MEASURE
+        Latency_Pend();
+    #endif
+}
+
+void Latency_Get(uint32_t* delays, uint32_t* i2c_isr)
+{
+    uint8_t interrupt_state = CyEnterCriticalSection();
+
+    for (uint8_t i = 0; i < LATENCY_SOURCES; i++)
+    {
+        delays[i] = worst_delay[i];
+    }
+    *i2c_isr = worst_isr;
+
+    CyExitCriticalSection(interrupt_state);
+}
+
+void Latency_Reset(void)
+{
+    uint8_t interrupt_state = CyEnterCriticalSection();
+
+    for (uint8_t i = 0; i < LATENCY_SOURCES; i++)
+    {
+        worst_delay[i] = 0;
+    }
+    worst_isr = 0;
+
+    CyExitCriticalSection(interrupt_state);
+}
+
+/* [] END OF FILE */
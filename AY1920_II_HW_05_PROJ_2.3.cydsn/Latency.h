@@ -0,0 +1,78 @@
+/**
+*   \file Latency.h
+*   \brief Priorities of the interrupts and measurement of their entry delay.
+*
+*   The components start with the priority chosen in the schematic, all at
+*   the lowest level by default, so any handler could delay the others.
+*   Latency_Start() applies a single plan, highest priority first:
+*   - I2C: every byte of a drain waits for the ISR of I2C_Master, the bus
+*     is stretched meanwhile and the FIFOs of the sensors keep filling.
+*   - UART: a byte received lasts 10 us at 1 Mbaud (BAUD_PROFILE_1000000)
+*     and the hardware FIFO holds 4 of them, it's drained by the SysTick
+*     (see Stream.h), the TX side is refilled by the ring.
+*   - INT1: the watermark of the FIFO leaves the rest of the FIFO as margin.
+*   - Timer: pacing only, its jitter is absorbed by the FIFOs.
+*   The sources not placed in the schematic (UART and timer interrupts,
+*   INT1 pin) get their level as soon as they are added, level 0 stays free.
+*
+*   With LATENCY_MEASURE set in cyapicallbacks.h, a probe interrupt on a
+*   spare vector is given in turn the priority of every source and pended
+*   both from the main loop and from the entry of the I2C ISR, the worst
+*   case for the lower levels. The time from the pend to the probe handler
+*   is the delay an event of that source would see, the maximum of the
+*   period is sent with the telemetry (see Telemetry.h) together with the
+*   longest run of the I2C ISR.
+*
+*   \author Simone Fiorani
+*   \date 2020
+*/
+
+#ifndef __LATENCY_H
+    #define __LATENCY_H
+
+    #include "cytypes.h"
+    #include "cyapicallbacks.h"
+
+    #define LATENCY_SOURCE_I2C 0        ///< ISR of I2C_Master
+    #define LATENCY_SOURCE_UART 1       ///< SysTick draining the RX FIFO, RX and TX interrupts of UART_Debug
+    #define LATENCY_SOURCE_INT1 2       ///< Watermark interrupt of the LIS3DH
+    #define LATENCY_SOURCE_TIMER 3      ///< Timer of the sampling
+    #define LATENCY_SOURCES 4           ///< Number of sources
+
+    #define LATENCY_PRIORITY_I2C 1      ///< NVIC level of the I2C, 0 is the highest
+    #define LATENCY_PRIORITY_UART 2     ///< NVIC level of the UART
+    #define LATENCY_PRIORITY_INT1 3     ///< NVIC level of INT1
+    #define LATENCY_PRIORITY_TIMER 4    ///< NVIC level of the timer
+
+    /**
+    *   \brief Spare interrupt used by the probe, no component is placed on it.
+    */
+    #define LATENCY_PROBE_IRQ 31u
+
+    /**
+    *   \brief Apply the priority plan, after the components have been started.
+    *
+    *   With LATENCY_MEASURE the probe is installed too.
+    */
+    void Latency_Start(void);
+
+    /**
+    *   \brief Pend a probe from the main loop, only with LATENCY_MEASURE.
+    */
+    void Latency_Task(void);
+
+    /**
+    *   \brief Worst values since the last reset, 0 without LATENCY_MEASURE.
+    *
+    *   \param delays Longest entry delay of every LATENCY_SOURCE_xxx, in cycles.
+    *   \param i2c_isr Longest run of the I2C ISR, in cycles.
+    */
+    void Latency_Get(uint32_t* delays, uint32_t* i2c_isr);
+
+    /**
+    *   \brief Clear the worst values.
+    */
+    void Latency_Reset(void);
+
+#endif
+/* [] END OF FILE */
@@ -0,0 +1,50 @@
+/*
+* This file includes the source code of the motion
+* energy of the sensors.
+*/
+
+#include "Motion.h"
+#include "RamCode.h"
+
+void Motion_Init(Motion* motion)
+{
+    for (uint8_t axis = 0; axis < 3; axis++)
+    {
+        motion->sum[axis] = 0;
+        motion->sum_sq[axis] = 0;
+    }
+    motion->count = 0;
+}
+
+RAM_CODE void Motion_Add(Motion* motion, const uint8_t* sample, uint8_t sensitivity)
+{
+    for (uint8_t axis = 0; axis < 3; axis++)
+    {
+        int32_t value = ((int16)((sample[2*axis] | (sample[2*axis+1]<<8)))>>4) * sensitivity;
+
+        motion->sum[axis] += value;
+        motion->sum_sq[axis] += (uint32_t)(value * value);
+    }
+
+    motion->count++;
+}
+
+uint32_t Motion_Energy(Motion* motion)
+{
+    uint64_t energy = 0;
+    int64_t n = motion->count;
+
+    for (uint8_t axis = 0; n >= 2 && axis < 3; axis++)
+    {
+        // n^2 var = n sum(x^2) - sum(x)^2, exact in 64 bit
+        int64_t sum = motion->sum[axis];
+
+        energy += (uint64_t)(n * (int64_t)motion->sum_sq[axis] - sum * sum) / (uint64_t)(n * n);
+    }
+
+    Motion_Init(motion);
+
+    return (energy > UINT32_MAX) ? UINT32_MAX : (uint32_t)energy;
+}
+
+/* [] END OF FILE */
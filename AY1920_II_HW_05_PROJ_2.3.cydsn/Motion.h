@@ -0,0 +1,53 @@
+/**
+*   \file Motion.h
+*   \brief Motion energy of a sensor over a time window.
+*
+*   The energy is the variance of the acceleration summed over the three
+*   axes, in mg^2: gravity and any constant offset are removed by the mean,
+*   only the movement is left. The window is defined by the caller in time,
+*   so the result doesn't depend on the data rate.
+*
+*   \author Simone Fiorani
+*   \date 2020
+*/
+
+#ifndef __MOTION_H
+    #define __MOTION_H
+
+    #include "cytypes.h"
+
+    /**
+    *   \brief Accumulators of the window of a sensor.
+    */
+    typedef struct {
+        int32_t sum[3];         ///< Sum of the samples, in mg
+        uint64_t sum_sq[3];     ///< Sum of the squares of the samples, in mg^2
+        uint16_t count;         ///< Samples collected so far, a window is far shorter than 65536 samples
+    } Motion;
+
+    /**
+    *   \brief Discard the samples collected so far.
+    *
+    *   \param motion Accumulators of the sensor.
+    */
+    void Motion_Init(Motion* motion);
+
+    /**
+    *   \brief Add a sample to the window.
+    *
+    *   \param motion Accumulators of the sensor.
+    *   \param sample LSB and MSB of the X, Y and Z axis, as read from the sensor.
+    *   \param sensitivity Sensitivity of the sensor in mg/digit.
+    */
+    void Motion_Add(Motion* motion, const uint8_t* sample, uint8_t sensitivity);
+
+    /**
+    *   \brief Energy of the window, then a new window is started.
+    *
+    *   \param motion Accumulators of the sensor.
+    *   \return Variance summed over the axes in mg^2, 0 with less than 2 samples.
+    */
+    uint32_t Motion_Energy(Motion* motion);
+
+#endif
+/* [] END OF FILE */
@@ -0,0 +1,152 @@
+/*
+* This file includes the source code of the lightweight
+* text output.
+*/
+
+#include "Print.h"
+#include "Stream.h"
+
+#if PRINT_USE_SNPRINTF
+    #include <stdio.h>
+#endif
+
+/**
+*   \brief Largest number of characters of a 32 bit number: sign, 10 digits and decimal point.
+*/
+#define PRINT_MAX_DIGITS 12
+
+/**
+*   \brief Largest number of decimals that fits in a 32 bit number.
+*/
+#define PRINT_MAX_DECIMALS 9
+
+/**
+*   \brief Longest piece of a string queued at once.
+*/
+#define PRINT_CHUNK_SIZE 32
+
+/**
+*   \brief Message buffer of the formatter of the C library, as before Print.h.
+*/
+#define PRINT_MESSAGE_SIZE 64
+
+void Print_String(const char* text)
+{
+    while (*text)
+    {
+        uint8_t count = 0;
+
+        while (text[count] && count < PRINT_CHUNK_SIZE)
+        {
+            count++;
+        }
+
+        Stream_Write((const uint8_t*)text, count);
+        text += count;
+    }
+}
+
+#if PRINT_USE_SNPRINTF
+
+void Print_Hex(uint32_t value, uint8_t digits)
+{
+    char message[PRINT_MESSAGE_SIZE];
+
+    if (digits > 8)
+    {
+        digits = 8;
+    }
+
+    snprintf(message, sizeof(message), "%0*lX", digits, (unsigned long)value & (0xFFFFFFFFul >> (32 - 4 * digits)));
+    Print_String(message);
+}
+
+void Print_Fixed(int32_t value, uint8_t decimals)
+{
+    char message[PRINT_MESSAGE_SIZE];
+    uint32_t magnitude = (value < 0) ? -(uint32_t)value : (uint32_t)value;
+    uint32_t scale = 1;
+
+    if (decimals > PRINT_MAX_DECIMALS)
+    {
+        decimals = PRINT_MAX_DECIMALS;
+    }
+
+    for (uint8_t i = 0; i < decimals; i++)
+    {
+        scale *= 10;
+    }
+
+    if (decimals > 0)
+    {
+        snprintf(message, sizeof(message), "%s%lu.%0*lu", (value < 0) ? "-" : "",
+                 (unsigned long)(magnitude / scale), decimals, (unsigned long)(magnitude % scale));
+    }
+    else
+    {
+        snprintf(message, sizeof(message), "%ld", (long)value);
+    }
+    Print_String(message);
+}
+
+#else
+
+void Print_Hex(uint32_t value, uint8_t digits)
+{
+    static const char hex[16] = "0123456789ABCDEF";
+    uint8_t out[8];
+
+    if (digits > 8)
+    {
+        digits = 8;
+    }
+
+    for (uint8_t i = digits; i > 0; i--)
+    {
+        out[i-1] = hex[value & 0xF];
+        value >>= 4;
+    }
+
+    Stream_Write(out, digits);
+}
+
+void Print_Fixed(int32_t value, uint8_t decimals)
+{
+    uint8_t out[PRINT_MAX_DIGITS];
+    uint8_t i = PRINT_MAX_DIGITS;
+    uint8_t digits = 0;
+    uint32_t magnitude = (value < 0) ? -(uint32_t)value : (uint32_t)value;
+
+    if (decimals > PRINT_MAX_DECIMALS)
+    {
+        decimals = PRINT_MAX_DECIMALS;
+    }
+
+    // Digits are produced from the least significant one, with at least one before the point
+    do
+    {
+        if (decimals > 0 && digits == decimals)
+        {
+            out[--i] = '.';
+        }
+        out[--i] = '0' + (magnitude % 10);
+        magnitude /= 10;
+        digits++;
+    } while (magnitude != 0 || digits <= decimals);
+
+    if (value < 0)
+    {
+        out[--i] = '-';
+    }
+
+    Stream_Write(&out[i], PRINT_MAX_DIGITS - i);
+}
+
+#endif
+
+void Print_Dec(int32_t value)
+{
+    Print_Fixed(value, 0);
+}
+
+/* [] END OF FILE */
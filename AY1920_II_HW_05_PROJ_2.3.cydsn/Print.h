@@ -0,0 +1,64 @@
+/**
+*   \file Print.h
+*   \brief Lightweight text output on the UART.
+*
+*   Replacement of sprintf for the messages of the firmware. Numbers are
+*   converted with a few divisions on a small stack buffer and the text is
+*   queued directly in the transmission ring of the stream, so no message
+*   buffer and no formatter of the C library are needed.
+*
+*   Set PRINT_USE_SNPRINTF to 1 to format the numbers with snprintf in a
+*   message buffer, as the firmware did before, with the same text (see
+*   test/print_bench.c). The difference between the map files of the two
+*   builds (`.text` and `.bss` of the image, the formatter of newlib being
+*   linked only by the second one) is the cost of the formatter; its stack
+*   is the one of the call tree of snprintf, given by -fstack-usage.
+*
+*   \author Simone Fiorani
+*   \date 2020
+*/
+
+#ifndef __PRINT_H
+    #define __PRINT_H
+
+    #include "cytypes.h"
+
+    /**
+    *   \brief 1 to format the numbers with snprintf, only to measure its cost.
+    */
+    #ifndef PRINT_USE_SNPRINTF
+        #define PRINT_USE_SNPRINTF 0
+    #endif
+
+    /**
+    *   \brief Queue a null terminated string.
+    *
+    *   \param text String to be sent.
+    */
+    void Print_String(const char* text);
+
+    /**
+    *   \brief Queue a number in hexadecimal format, without prefix.
+    *
+    *   \param value Number to be sent.
+    *   \param digits Number of digits, from 1 to 8, padded with zeros.
+    */
+    void Print_Hex(uint32_t value, uint8_t digits);
+
+    /**
+    *   \brief Queue a signed number in decimal format.
+    *
+    *   \param value Number to be sent.
+    */
+    void Print_Dec(int32_t value);
+
+    /**
+    *   \brief Queue a fixed point number in decimal format.
+    *
+    *   \param value Number multiplied by 10^decimals.
+    *   \param decimals Number of digits after the decimal point.
+    */
+    void Print_Fixed(int32_t value, uint8_t decimals);
+
+#endif
+/* [] END OF FILE */
@@ -0,0 +1,52 @@
+/**
+*   \file RamCode.h
+*   \brief Placement of the code of the sample path in SRAM.
+*
+*   The functions run for every sample (drain state machine, I2C
+*   completion, filter, conversion and framing) are marked with RAM_CODE.
+*   They are linked in the `.ram` input section, that cm3gcc.ld already
+*   places in the `.data` output section: the startup code copies them
+*   from flash to SRAM together with the initialized variables, so they
+*   are fetched without the wait states of the flash at high clocks.
+*
+*   The size of the hot code is reported in the map file (Generate Map
+*   File is enabled in the linker options): the `.ram` input sections are
+*   listed under `.data`, one line per object file with its size.
+*
+*   RAM_CODE_ENABLE is 0 by default: the flash is read through the
+*   instruction cache of the CPU, so the gain depends on the loops and no
+*   cycles per sample have been measured on the target yet to pay for the
+*   SRAM taken. To decide, build with 0 and with 1 and, at every clock
+*   profile, compare the cycles per sample of the telemetry (field 11 over
+*   field 0, see Telemetry.h) and the rate of COMMAND_BENCHMARK against
+*   the size of the `.ram` sections; enable it only where the gain shows.
+*
+*   \author Simone Fiorani
+*   \date 2020
+*/
+
+#ifndef __RAM_CODE_H
+    #define __RAM_CODE_H
+
+    #include "cytypes.h"
+
+    /**
+    *   \brief 1 to run the sample path from SRAM, 0 from flash.
+    */
+    #ifndef RAM_CODE_ENABLE
+        #define RAM_CODE_ENABLE 0
+    #endif
+
+    /**
+    *   \brief Attribute of the definition of a function of the sample path.
+    *
+    *   Inlining is prevented, so that every function has a single copy in SRAM.
+    */
+    #if RAM_CODE_ENABLE
+        #define RAM_CODE CY_SECTION(".ram") __attribute__((noinline))
+    #else
+        #define RAM_CODE
+    #endif
+
+#endif
+/* [] END OF FILE */
@@ -0,0 +1,97 @@
+/*
+* This file includes the source code of the self-test
+* of the LIS3DH.
+*/
+
+#include "SelfTest.h"
+#include "CyLib.h"
+
+/**
+*   \brief Average a full FIFO of samples in the current configuration.
+*
+*   \param mean Mean of the X, Y and Z axis in mg.
+*/
+static ErrorCode SelfTest_Average(LIS3DH_Handle* dev, int32_t* mean)
+{
+    uint8_t data[LIS3DH_FIFO_SIZE * LIS3DH_SAMPLE_SIZE];
+    uint8_t count;
+
+    // The samples taken while the output settles are discarded with the FIFO
+    CyDelay(SELF_TEST_SETTLE_MS);
+    ErrorCode error = LIS3DH_RestartFifo(dev, LIS3DH_FIFO_MODE_STREAM);
+
+    CyDelay(SELF_TEST_FILL_MS);
+    if (error == NO_ERROR)
+    {
+        error = LIS3DH_ReadFifo(dev, data, LIS3DH_FIFO_SIZE, &count);
+    }
+    if (error != NO_ERROR || count == 0)
+    {
+        return ERROR;
+    }
+
+    for (uint8_t axis = 0; axis < 3; axis++)
+    {
+        int32_t sum = 0;
+
+        for (uint8_t i = 0; i < count; i++)
+        {
+            const uint8_t* sample = &data[i * LIS3DH_SAMPLE_SIZE + 2 * axis];
+
+            sum += (int16)(sample[0] | (sample[1]<<8)) >> 4;   // 1 mg/digit at +-2g
+        }
+        mean[axis] = sum / count;
+    }
+
+    return NO_ERROR;
+}
+
+ErrorCode SelfTest_Run(LIS3DH_Handle* dev, int16_t* delta)
+{
+    uint8_t saved_ctrl1 = LIS3DH_GetRegister(dev, LIS3DH_CTRL_REG1);
+    uint8_t saved_ctrl4 = LIS3DH_GetRegister(dev, LIS3DH_CTRL_REG4);
+    uint8_t saved_mode = LIS3DH_GetRegister(dev, LIS3DH_FIFO_CTRL_REG) & LIS3DH_FIFO_CTRL_FM_MASK;
+    int32_t normal[3];
+    int32_t test[3];
+
+    LIS3DH_SetDataRate(dev, LIS3DH_ODR_1344HZ);
+    LIS3DH_UpdateBits(dev, LIS3DH_CTRL_REG1, LIS3DH_CTRL_REG1_LPEN, 0);
+    LIS3DH_SetRegister(dev, LIS3DH_CTRL_REG4, LIS3DH_CTRL_REG4_BDU | LIS3DH_FS_2G | LIS3DH_ST_NORMAL);
+
+    ErrorCode error = LIS3DH_Commit(dev);
+    if (error == NO_ERROR)
+    {
+        error = SelfTest_Average(dev, normal);
+    }
+
+    LIS3DH_UpdateBits(dev, LIS3DH_CTRL_REG4, LIS3DH_CTRL_REG4_ST_MASK, LIS3DH_ST_0);
+    if (error == NO_ERROR)
+    {
+        error = LIS3DH_Commit(dev);
+    }
+    if (error == NO_ERROR)
+    {
+        error = SelfTest_Average(dev, test);
+    }
+
+    // The configuration is restored even if the test failed
+    LIS3DH_SetRegister(dev, LIS3DH_CTRL_REG1, saved_ctrl1);
+    LIS3DH_SetRegister(dev, LIS3DH_CTRL_REG4, saved_ctrl4);
+    LIS3DH_Commit(dev);
+    LIS3DH_RestartFifo(dev, saved_mode);
+
+    for (uint8_t axis = 0; axis < 3; axis++)
+    {
+        delta[axis] = (error == NO_ERROR) ? test[axis] - normal[axis] : 0;
+
+        int16_t magnitude = (delta[axis] < 0) ? -delta[axis] : delta[axis];
+        if (magnitude < SELF_TEST_MIN_MG || magnitude > SELF_TEST_MAX_MG)
+        {
+            error = ERROR;
+        }
+    }
+
+    return error;
+}
+
+/* [] END OF FILE */
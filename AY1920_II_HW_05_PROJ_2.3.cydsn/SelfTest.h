@@ -0,0 +1,58 @@
+/**
+*   \file SelfTest.h
+*   \brief Built-in self-test of the LIS3DH.
+*
+*   The self-test applies an electrostatic force to the proof mass, so a
+*   working sensor moves its output by a known amount. A full FIFO of
+*   samples is averaged with the self-test disabled and then enabled, and
+*   the change of every axis is compared with the limits of the datasheet.
+*   At 1.344 kHz each average is a single FIFO burst, the whole test takes
+*   about 60 ms.
+*
+*   The test runs in the conditions of the datasheet, normal mode at +-2g,
+*   and the configuration of the sensor is restored at the end.
+*
+*   \author Simone Fiorani
+*   \date 2020
+*/
+
+#ifndef __SELF_TEST_H
+    #define __SELF_TEST_H
+
+    #include "cytypes.h"
+    #include "ErrorCodes.h"
+    #include "LIS3DH.h"
+
+    /**
+    *   \brief Time for the output to settle after a change of configuration, in ms.
+    */
+    #define SELF_TEST_SETTLE_MS 5
+
+    /**
+    *   \brief Time to fill the FIFO at 1.344 kHz (23.8 ms) plus margin, in ms.
+    */
+    #define SELF_TEST_FILL_MS 25
+
+    /**
+    *   \brief Minimum change of the output, in mg (17 digits of 4 mg in normal mode at +-2g).
+    */
+    #define SELF_TEST_MIN_MG 68
+
+    /**
+    *   \brief Maximum change of the output, in mg (360 digits of 4 mg in normal mode at +-2g).
+    */
+    #define SELF_TEST_MAX_MG 1440
+
+    /**
+    *   \brief Run the self-test of a sensor.
+    *
+    *   The FIFO is restarted in the mode it had before the test.
+    *   \param dev Handle of the device.
+    *   \param delta Change of the X, Y and Z output in mg, 0 if the bus failed.
+    *   \retval NO_ERROR if the change of every axis is within the limits.
+    *   \retval ERROR if some axis is out of the limits or the bus failed.
+    */
+    ErrorCode SelfTest_Run(LIS3DH_Handle* dev, int16_t* delta);
+
+#endif
+/* [] END OF FILE */
@@ -0,0 +1,163 @@
+/*
+* This file includes the source code of the Q15 FFT
+* and of the spectrum of the accelerometer axes.
+*/
+
+#include "Spectrum.h"
+#include "FixedMath.h"
+
+/**
+*   \brief sin(2 pi k / SPECTRUM_SIZE) in Q15, for the first quarter of the period.
+*/
+static const int16_t quarter_sine[SPECTRUM_SIZE / 4 + 1] = {
+    0, 804, 1608, 2410, 3212, 4011, 4808, 5602,
+    6393, 7179, 7962, 8739, 9512, 10278, 11039, 11793,
+    12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530,
+    18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594,
+    23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790,
+    27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+    30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971,
+    32137, 32285, 32412, 32521, 32609, 32678, 32728, 32757,
+    32767,
+};
+
+/**
+*   \brief round(8 log2(1 + i/8)), fractional part of the logarithm of the magnitude.
+*/
+static const uint8_t log2_fraction[8] = { 0, 1, 3, 4, 5, 6, 6, 7 };
+
+// Work buffers of the FFT, shared by all the sensors
+static int16_t re[SPECTRUM_SIZE];
+static int16_t im[SPECTRUM_SIZE];
+
+/**
+*   \brief sin(2 pi k / SPECTRUM_SIZE) in Q15, for k from 0 to SPECTRUM_SIZE/2.
+*/
+static int32_t Spectrum_Sin(uint16_t k)
+{
+    return (k <= SPECTRUM_SIZE / 4) ? quarter_sine[k] : quarter_sine[SPECTRUM_SIZE / 2 - k];
+}
+
+/**
+*   \brief cos(2 pi k / SPECTRUM_SIZE) in Q15, for k from 0 to SPECTRUM_SIZE - 1.
+*/
+static int32_t Spectrum_Cos(uint16_t k)
+{
+    if (k <= SPECTRUM_SIZE / 4)
+    {
+        return quarter_sine[SPECTRUM_SIZE / 4 - k];
+    }
+    if (k <= 3 * SPECTRUM_SIZE / 4)
+    {
+        return -Spectrum_Sin(k - SPECTRUM_SIZE / 4);
+    }
+    return quarter_sine[k - 3 * SPECTRUM_SIZE / 4];
+}
+
+/**
+*   \brief 8 log2(value), 0 for a null value.
+*/
+static uint8_t Spectrum_Log2(uint16_t value)
+{
+    uint8_t msb = 0;
+
+    if (value == 0)
+    {
+        return 0;
+    }
+
+    while ((value >> msb) > 1)
+    {
+        msb++;
+    }
+
+    // The three bits after the most significant one give the fraction
+    uint8_t fraction = (msb >= 3) ? (value >> (msb - 3)) & 0x7 : (value << (3 - msb)) & 0x7;
+
+    return 8 * msb + log2_fraction[fraction];
+}
+
+/**
+*   \brief In place radix-2 decimation in time FFT of the work buffers.
+*
+*   The input must be in bit reversed order, every stage scales by 1/2.
+*/
+static void Spectrum_FFT(void)
+{
+    for (uint16_t size = 2; size <= SPECTRUM_SIZE; size <<= 1)
+    {
+        uint16_t half = size >> 1;
+        uint16_t step = SPECTRUM_SIZE / size;
+
+        for (uint16_t k = 0; k < half; k++)
+        {
+            // The twiddle factor is the same for all the butterflies of this column
+            int32_t wr = Spectrum_Cos(k * step);
+            int32_t wi = -Spectrum_Sin(k * step);
+
+            for (uint16_t i = k; i < SPECTRUM_SIZE; i += size)
+            {
+                uint16_t j = i + half;
+
+                int32_t tr = (wr * re[j] - wi * im[j]) >> 15;
+                int32_t ti = (wr * im[j] + wi * re[j]) >> 15;
+
+                re[j] = (re[i] - tr) >> 1;
+                im[j] = (im[i] - ti) >> 1;
+                re[i] = (re[i] + tr) >> 1;
+                im[i] = (im[i] + ti) >> 1;
+            }
+        }
+    }
+}
+
+void Spectrum_Init(Spectrum* spectrum)
+{
+    spectrum->count = 0;
+}
+
+uint8_t Spectrum_Add(Spectrum* spectrum, const uint8_t* sample)
+{
+    for (uint8_t axis = 0; axis < SPECTRUM_AXES; axis++)
+    {
+        spectrum->samples[axis][spectrum->count] = (int16)(sample[2*axis] | (sample[2*axis+1]<<8));
+    }
+
+    if (++spectrum->count < SPECTRUM_SIZE)
+    {
+        return 0;
+    }
+    spectrum->count = 0;    // The next window starts while this one is computed
+
+    return 1;
+}
+
+void Spectrum_Compute(const Spectrum* spectrum, uint8_t axis, uint8_t* bins)
+{
+    const int16_t* x = spectrum->samples[axis];
+
+    // Hann window, sin^2(pi n / N) = (1 - cos(2 pi n / N)) / 2, loaded in bit reversed order
+    for (uint16_t n = 0; n < SPECTRUM_SIZE; n++)
+    {
+        uint16_t reversed = 0;
+        for (uint8_t b = 0; b < SPECTRUM_LOG2_SIZE; b++)
+        {
+            reversed |= ((n >> b) & 1) << (SPECTRUM_LOG2_SIZE - 1 - b);
+        }
+
+        int32_t hann = (32768 - Spectrum_Cos(n)) >> 1;
+
+        re[reversed] = (x[n] * hann) >> 16;     // Q15 product, scaled by 1/2 for the guard bit
+        im[reversed] = 0;
+    }
+
+    Spectrum_FFT();
+
+    for (uint16_t k = 0; k < SPECTRUM_BINS; k++)
+    {
+        uint32_t power = (uint32_t)(re[k] * re[k]) + (uint32_t)(im[k] * im[k]);
+        bins[k] = Spectrum_Log2(FixedMath_Sqrt(power));
+    }
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,80 @@
+/**
+*   \file Spectrum.h
+*   \brief Vibration spectrum of the accelerometer axes.
+*
+*   The samples of a sensor are collected in windows of SPECTRUM_SIZE
+*   samples per axis. Every full window is multiplied by a Hann window and
+*   transformed with a radix-2 fixed point FFT in Q15. Only the magnitude
+*   of the first SPECTRUM_BINS bins is kept, as an 8 bit logarithm in
+*   steps of 1/8 of octave (0.75 dB): bin = 8 log2(|X|), so the host gets
+*   back |X| = 2^(bin/8).
+*
+*   Every stage of the FFT scales the data by 1/2 and the input is scaled
+*   by 1/2 to leave a guard bit, so |X| is the magnitude of the
+*   transform divided by 2 x SPECTRUM_SIZE, in digits of the left aligned
+*   16 bit samples.
+*
+*   \author Simone Fiorani
+*   \date 2020
+*/
+
+#ifndef __SPECTRUM_H
+    #define __SPECTRUM_H
+
+    #include "cytypes.h"
+
+    /**
+    *   \brief Base 2 logarithm of the size of the window.
+    */
+    #define SPECTRUM_LOG2_SIZE 8
+
+    /**
+    *   \brief Samples per axis in a window.
+    */
+    #define SPECTRUM_SIZE (1 << SPECTRUM_LOG2_SIZE)
+
+    /**
+    *   \brief Bins of the spectrum, from DC to half the data rate.
+    */
+    #define SPECTRUM_BINS (SPECTRUM_SIZE / 2)
+
+    /**
+    *   \brief Number of axes of a sample.
+    */
+    #define SPECTRUM_AXES 3
+
+    /**
+    *   \brief Window being collected for a sensor.
+    */
+    typedef struct {
+        int16_t samples[SPECTRUM_AXES][SPECTRUM_SIZE];  ///< Left aligned samples of every axis
+        uint16_t count;                                 ///< Samples collected so far
+    } Spectrum;
+
+    /**
+    *   \brief Discard the samples collected so far.
+    *
+    *   \param spectrum Window of the sensor.
+    */
+    void Spectrum_Init(Spectrum* spectrum);
+
+    /**
+    *   \brief Add a sample to the window.
+    *
+    *   \param spectrum Window of the sensor.
+    *   \param sample LSB and MSB of the X, Y and Z axis, as read from the sensor.
+    *   \return 1 if the window is full and the spectra must be computed.
+    */
+    uint8_t Spectrum_Add(Spectrum* spectrum, const uint8_t* sample);
+
+    /**
+    *   \brief Compute the spectrum of an axis of a full window.
+    *
+    *   \param spectrum Window of the sensor.
+    *   \param axis 0 for X, 1 for Y, 2 for Z.
+    *   \param bins Logarithmic magnitude of the SPECTRUM_BINS bins.
+    */
+    void Spectrum_Compute(const Spectrum* spectrum, uint8_t axis, uint8_t* bins);
+
+#endif
+/* [] END OF FILE */
@@ -0,0 +1,404 @@
+/*
+* This file includes the source code that builds the frames
+* of the data stream and sends them through UART.
+*/
+
+#include "Stream.h"
+#include "CyLib.h"
+#include "RamCode.h"
+#include "Timing.h"
+#include "UART_Debug.h"
+
+/**
+*   \brief Mask of the indexes of the transmission ring.
+*/
+#define STREAM_TX_INDEX_MASK (STREAM_TX_BUFFER_SIZE - 1)
+
+/**
+*   \brief Mask of the indexes of the reception ring.
+*/
+#define STREAM_RX_INDEX_MASK (STREAM_RX_BUFFER_SIZE - 1)
+
+static uint8_t tx_buffer[STREAM_TX_BUFFER_SIZE];   // Bytes waiting for the UART
+static uint16_t tx_head;                            // Next byte to be written
+static uint16_t tx_tail;                            // Next byte to be sent
+static uint16_t tx_high_water;                      // Largest number of bytes waiting since the last reset
+static uint32_t stall_cycles;                       // Cycles spent waiting for room in the ring
+
+static uint8_t rx_buffer[STREAM_RX_BUFFER_SIZE];   // Bytes received, waiting for the parser
+static volatile uint8_t rx_head;                    // Next byte to be written, by the SysTick handler
+static volatile uint8_t rx_tail;                    // Next byte to be read
+
+RAM_CODE void Stream_Pump(void)
+{
+    while (tx_tail != tx_head && (UART_Debug_ReadTxStatus() & UART_Debug_TX_STS_FIFO_NOT_FULL))
+    {
+        UART_Debug_WriteTxData(tx_buffer[tx_tail]);
+        tx_tail = (tx_tail + 1) & STREAM_TX_INDEX_MASK;
+    }
+}
+
+RAM_CODE uint16_t Stream_TxFree(void)
+{
+    // One byte is always left empty to distinguish a full ring from an empty one
+    return (tx_tail - tx_head - 1) & STREAM_TX_INDEX_MASK;
+}
+
+uint16_t Stream_GetHighWater(void)
+{
+    return tx_high_water;
+}
+
+void Stream_ResetHighWater(void)
+{
+    tx_high_water = 0;
+}
+
+uint32_t Stream_GetStallCycles(void)
+{
+    return stall_cycles;
+}
+
+void Stream_Flush(void)
+{
+    while (tx_tail != tx_head)
+    {
+        Stream_Pump();
+    }
+
+    while ((UART_Debug_ReadTxStatus() & UART_Debug_TX_STS_FIFO_EMPTY) == 0)
+    {
+        // The hardware FIFO is being emptied
+    }
+}
+
+/**
+*   \brief Move the bytes received from the hardware FIFO to the reception ring.
+*
+*   The bytes that don't fit are dropped, the parser then discards the
+*   incomplete packet.
+*/
+RAM_CODE static CY_ISR(Stream_RxTick)
+{
+    while (UART_Debug_ReadRxStatus() & UART_Debug_RX_STS_FIFO_NOTEMPTY)
+    {
+        uint8_t data = UART_Debug_ReadRxData();
+        uint8_t next = (rx_head + 1) & STREAM_RX_INDEX_MASK;
+
+        if (next != rx_tail)
+        {
+            rx_buffer[rx_head] = data;
+            rx_head = next;
+        }
+    }
+}
+
+void Stream_StartRx(uint32_t char_cycles)
+{
+    CySysTickStart();
+    (void)CyIntSetSysVector(CY_INT_SYSTICK_IRQN, &Stream_RxTick);  // No callbacks, the tick only drains the FIFO
+    Stream_RetuneRx(char_cycles);
+}
+
+void Stream_RetuneRx(uint32_t char_cycles)
+{
+    uint8_t interrupt_state = CyEnterCriticalSection();
+
+    CySysTickSetReload(char_cycles * STREAM_RX_TICK_CHARS - 1);
+    CySysTickClear();
+    UART_Debug_ClearRxBuffer();
+    rx_tail = rx_head;
+
+    CyExitCriticalSection(interrupt_state);
+}
+
+uint8_t Stream_ReadRx(uint8_t* data)
+{
+    if (rx_tail == rx_head)
+    {
+        return 0;
+    }
+
+    *data = rx_buffer[rx_tail];
+    rx_tail = (rx_tail + 1) & STREAM_RX_INDEX_MASK;
+    return 1;
+}
+
+/**
+*   \brief Wait for room in the ring, the time spent is counted as stall.
+*/
+RAM_CODE static void Stream_WaitRoom(uint16_t count)
+{
+    if (Stream_TxFree() < count)
+    {
+        uint32_t start = Timing_Now();
+
+        while (Stream_TxFree() < count)
+        {
+            Stream_Pump();
+        }
+        stall_cycles += Timing_Elapsed(start);
+    }
+}
+
+RAM_CODE void Stream_Write(const uint8_t* data, uint8_t count)
+{
+    Stream_WaitRoom(count);
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        tx_buffer[tx_head] = data[i];
+        tx_head = (tx_head + 1) & STREAM_TX_INDEX_MASK;
+    }
+
+    uint16_t used = (STREAM_TX_BUFFER_SIZE - 1) - Stream_TxFree();
+    if (used > tx_high_water)
+    {
+        tx_high_water = used;
+    }
+
+    Stream_Pump();
+}
+
+RAM_CODE void Stream_SendAcc(uint8_t channel, const Calibration_Axis* axes, const uint8_t* AccData)
+{
+    uint8_t OutArray[STREAM_ACC_FRAME_SIZE];   // The final packet sent by UART
+    int32_t Out[3];
+
+    OutArray[0] = STREAM_TYPE_ACC | channel;    // First byte of the string is the header, tagged with the sensor
+
+    Calibration_Convert(axes, AccData, Out);    // Sensitivity, gain, offset and the gravity acceleration (9.806)
+                                                //      are folded in a multiply-add per axis, the result is in mm/s^2
+
+    for (uint8_t axis = 0; axis < 3; axis++)
+    {
+        OutArray[4*axis+1] = (uint8_t)(Out[axis] & 0xFF); // Separation of the int32 in the 4 byte that will be sent
+        OutArray[4*axis+2] = (uint8_t)(Out[axis] >> 8);   //      to the UART. The order il LSB - MSB
+        OutArray[4*axis+3] = (uint8_t)(Out[axis] >> 16);
+        OutArray[4*axis+4] = (uint8_t)(Out[axis] >> 24);
+    }
+
+    OutArray[STREAM_ACC_FRAME_SIZE-1] = STREAM_FOOTER;  // Last byte of the string is the footer
+
+    Stream_Write(OutArray, STREAM_ACC_FRAME_SIZE);  // Queue of the complete string for the UART
+}
+
+RAM_CODE void Stream_SendRaw(uint8_t channel, const uint8_t* AccData)
+{
+    uint8_t OutArray[STREAM_RAW_FRAME_SIZE];
+
+    OutArray[0] = STREAM_TYPE_RAW | channel;
+
+    for (uint8_t axis = 0; axis < 3; axis++)
+    {
+        int16_t OutTemp = (int16)((AccData[2*axis] | (AccData[2*axis+1]<<8)))>>4;  // Right aligned 12 bit value
+
+        OutArray[2*axis+1] = (uint8_t)(OutTemp & 0xFF);
+        OutArray[2*axis+2] = (uint8_t)(OutTemp >> 8);
+    }
+
+    OutArray[STREAM_RAW_FRAME_SIZE-1] = STREAM_FOOTER;
+
+    Stream_Write(OutArray, STREAM_RAW_FRAME_SIZE);
+}
+
+RAM_CODE void Stream_SendRaw8(uint8_t channel, const uint8_t* packed, uint8_t count)
+{
+    uint8_t OutArray[STREAM_RAW8_HEADER_SIZE] = { STREAM_TYPE_RAW8 | channel, count };
+    uint8_t footer = STREAM_FOOTER;
+    uint8_t size = count * LIS3DH_PACKED_SAMPLE_SIZE;
+
+    // Room for the whole frame first, so that its pieces are never interleaved with other frames
+    Stream_WaitRoom(STREAM_RAW8_HEADER_SIZE + size + 1);
+
+    Stream_Write(OutArray, STREAM_RAW8_HEADER_SIZE);
+    Stream_Write(packed, size);
+    Stream_Write(&footer, 1);
+}
+
+RAM_CODE void Stream_SendTilt(uint8_t channel, int16_t pitch, int16_t roll)
+{
+    uint8_t OutArray[STREAM_TILT_FRAME_SIZE] = {
+        STREAM_TYPE_TILT | channel,
+        (uint8_t)(pitch & 0xFF), (uint8_t)(pitch >> 8),
+        (uint8_t)(roll & 0xFF), (uint8_t)(roll >> 8),
+        STREAM_FOOTER
+    };
+
+    Stream_Write(OutArray, STREAM_TILT_FRAME_SIZE);
+}
+
+void Stream_SendImpact(uint8_t channel, uint16_t peak, uint16_t duration, uint32_t timestamp)
+{
+    uint8_t OutArray[STREAM_IMPACT_FRAME_SIZE] = {
+        STREAM_TYPE_IMPACT | channel,
+        (uint8_t)(peak & 0xFF), (uint8_t)(peak >> 8),
+        (uint8_t)(duration & 0xFF), (uint8_t)(duration >> 8),
+        (uint8_t)(timestamp & 0xFF), (uint8_t)(timestamp >> 8),
+        (uint8_t)(timestamp >> 16), (uint8_t)(timestamp >> 24),
+        STREAM_FOOTER
+    };
+
+    Stream_Write(OutArray, STREAM_IMPACT_FRAME_SIZE);
+}
+
+void Stream_SendAux(uint8_t channel, const int16_t* adc)
+{
+    uint8_t OutArray[STREAM_AUX_FRAME_SIZE];
+
+    OutArray[0] = STREAM_TYPE_AUX | channel;
+
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        OutArray[2*i+1] = (uint8_t)(adc[i] & 0xFF);    // LSB - MSB order, as in the accelerometer frame
+        OutArray[2*i+2] = (uint8_t)(adc[i] >> 8);
+    }
+
+    OutArray[STREAM_AUX_FRAME_SIZE-1] = STREAM_FOOTER;
+
+    Stream_Write(OutArray, STREAM_AUX_FRAME_SIZE);
+}
+
+void Stream_SendFeatures(uint8_t channel, const Features_Axis* features)
+{
+    uint8_t OutArray[STREAM_FEATURES_FRAME_SIZE];
+    uint8_t index = 1;
+
+    OutArray[0] = STREAM_TYPE_FEATURES | channel;
+
+    for (uint8_t axis = 0; axis < FEATURES_AXES; axis++)
+    {
+        const uint16_t values[6] = {
+            features[axis].mean, features[axis].rms, features[axis].min,
+            features[axis].max, features[axis].p2p, features[axis].crest
+        };
+
+        for (uint8_t i = 0; i < 6; i++)
+        {
+            OutArray[index++] = (uint8_t)(values[i] & 0xFF);   // LSB first
+            OutArray[index++] = (uint8_t)(values[i] >> 8);
+        }
+    }
+
+    OutArray[STREAM_FEATURES_FRAME_SIZE-1] = STREAM_FOOTER;
+
+    Stream_Write(OutArray, STREAM_FEATURES_FRAME_SIZE);
+}
+
+void Stream_SendTelemetry(const uint32_t* fields)
+{
+    uint8_t OutArray[STREAM_TELEMETRY_FRAME_SIZE];
+
+    OutArray[0] = STREAM_TYPE_TELEMETRY;
+
+    for (uint8_t i = 0; i < STREAM_TELEMETRY_FIELDS; i++)
+    {
+        OutArray[4*i+1] = (uint8_t)(fields[i] & 0xFF);
+        OutArray[4*i+2] = (uint8_t)(fields[i] >> 8);
+        OutArray[4*i+3] = (uint8_t)(fields[i] >> 16);
+        OutArray[4*i+4] = (uint8_t)(fields[i] >> 24);
+    }
+
+    OutArray[STREAM_TELEMETRY_FRAME_SIZE-1] = STREAM_FOOTER;
+
+    Stream_Write(OutArray, STREAM_TELEMETRY_FRAME_SIZE);
+}
+
+void Stream_SendGap(uint8_t channel, uint8_t cause, uint32_t lost)
+{
+    uint16_t count = (lost > 0xFFFF) ? 0xFFFF : lost;
+    uint8_t OutArray[STREAM_GAP_FRAME_SIZE] = {
+        STREAM_TYPE_GAP | channel, cause, (uint8_t)(count & 0xFF), (uint8_t)(count >> 8), STREAM_FOOTER
+    };
+
+    Stream_Write(OutArray, STREAM_GAP_FRAME_SIZE);
+}
+
+void Stream_SendCapture(uint8_t channel, uint8_t pre, uint8_t post, uint16_t gap_us)
+{
+    uint8_t OutArray[STREAM_CAPTURE_FRAME_SIZE] = {
+        STREAM_TYPE_CAPTURE | channel, pre, post, (uint8_t)(gap_us & 0xFF), (uint8_t)(gap_us >> 8), STREAM_FOOTER
+    };
+
+    Stream_Write(OutArray, STREAM_CAPTURE_FRAME_SIZE);
+}
+
+void Stream_SendEvent(uint8_t channel, uint8_t event, uint8_t value)
+{
+    uint8_t OutArray[STREAM_EVENT_FRAME_SIZE] = { STREAM_TYPE_EVENT | channel, event, value, STREAM_FOOTER };
+
+    Stream_Write(OutArray, STREAM_EVENT_FRAME_SIZE);
+}
+
+void Stream_SendStatus(uint8_t opcode, uint8_t result, uint8_t value)
+{
+    uint8_t OutArray[STREAM_STATUS_FRAME_SIZE] = { STREAM_TYPE_STATUS, opcode, result, value, STREAM_FOOTER };
+
+    Stream_Write(OutArray, STREAM_STATUS_FRAME_SIZE);
+}
+
+void Stream_SendSpectrum(uint8_t channel, uint8_t axis, const uint8_t* bins, uint8_t count)
+{
+    uint8_t OutArray[STREAM_SPECTRUM_HEADER_SIZE] = { STREAM_TYPE_SPECTRUM | channel, axis };
+    uint8_t footer = STREAM_FOOTER;
+
+    // Room for the whole frame first, so that its pieces are never interleaved with other frames
+    Stream_WaitRoom(STREAM_SPECTRUM_HEADER_SIZE + count + 1);
+
+    Stream_Write(OutArray, STREAM_SPECTRUM_HEADER_SIZE);
+    Stream_Write(bins, count);
+    Stream_Write(&footer, 1);
+}
+
+void Stream_SendPattern(uint8_t sequence)
+{
+    uint8_t OutArray[STREAM_PATTERN_FRAME_SIZE];
+
+    OutArray[0] = STREAM_TYPE_TEST | STREAM_TEST_PATTERN;
+    OutArray[1] = sequence;
+
+    for (uint8_t i = 0; i < STREAM_PATTERN_SIZE; i++)
+    {
+        OutArray[i+2] = sequence + i;   // The host can check every byte
+    }
+
+    OutArray[STREAM_PATTERN_FRAME_SIZE-1] = STREAM_FOOTER;
+
+    Stream_Write(OutArray, STREAM_PATTERN_FRAME_SIZE);
+}
+
+void Stream_SendThroughput(uint32_t bytes_per_s, uint32_t baud)
+{
+    uint8_t OutArray[STREAM_RESULT_FRAME_SIZE];
+
+    OutArray[0] = STREAM_TYPE_TEST | STREAM_TEST_RESULT;
+
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        OutArray[i+1] = (uint8_t)(bytes_per_s >> (8*i));   // LSB first
+        OutArray[i+5] = (uint8_t)(baud >> (8*i));
+    }
+
+    OutArray[STREAM_RESULT_FRAME_SIZE-1] = STREAM_FOOTER;
+
+    Stream_Write(OutArray, STREAM_RESULT_FRAME_SIZE);
+}
+
+void Stream_SendBenchmark(uint32_t samples_per_s, uint32_t clock_hz)
+{
+    uint8_t OutArray[STREAM_RESULT_FRAME_SIZE];
+
+    OutArray[0] = STREAM_TYPE_TEST | STREAM_TEST_BENCHMARK;
+
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        OutArray[i+1] = (uint8_t)(samples_per_s >> (8*i));   // LSB first
+        OutArray[i+5] = (uint8_t)(clock_hz >> (8*i));
+    }
+
+    OutArray[STREAM_RESULT_FRAME_SIZE-1] = STREAM_FOOTER;
+
+    Stream_Write(OutArray, STREAM_RESULT_FRAME_SIZE);
+}
+
+/* [] END OF FILE */
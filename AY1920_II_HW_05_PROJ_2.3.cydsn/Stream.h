@@ -0,0 +1,317 @@
+/**
+*   \file Stream.h
+*   \brief Framing of the data stream sent through UART.
+*
+*   All the data share the same UART link as tagged frames. The high nibble
+*   of the header identifies the type of frame, the low nibble the channel
+*   ID of the sensor that produced it. Every frame ends with STREAM_FOOTER.
+*
+*   Frames are queued in a software ring and moved to the UART by
+*   Stream_Pump(), so that the transmission can go on while the CPU waits
+*   for the I2C bus. A frame is only queued when it fits in the ring.
+*
+*   The bytes received are moved by the SysTick handler from the hardware
+*   FIFO of UART_Debug (UART_Debug_RX_BUFFER_SIZE bytes) to a reception
+*   ring, every STREAM_RX_TICK_CHARS characters at the baud rate in use, so
+*   they are kept while the main loop is busy. The RX interrupt of the
+*   component is disabled in the schematic and can only be enabled by
+*   regenerating the design, the SysTick needs no routing.
+*
+*   \author Simone Fiorani
+*   \date 2020
+*/
+
+#ifndef __STREAM_H
+    #define __STREAM_H
+
+    #include "cytypes.h"
+    #include "Calibration.h"
+    #include "Features.h"
+
+    /**
+    *   \brief Footer of every frame.
+    */
+    #define STREAM_FOOTER 0xC0
+
+    /**
+    *   \brief Mask of the frame type in the header.
+    */
+    #define STREAM_TYPE_MASK 0xF0
+
+    /**
+    *   \brief Mask of the channel ID in the header.
+    */
+    #define STREAM_CHANNEL_MASK 0x0F
+
+    #define STREAM_TYPE_RAW8 0x10   ///< Accelerometer samples in low power mode: count, then X, Y, Z as int8 for every sample
+    #define STREAM_TYPE_IMPACT 0x20   ///< End of an impact: peak magnitude in mg, duration in samples and index of the first sample
+    #define STREAM_TYPE_TILT 0x30     ///< Orientation from the gravity vector: pitch and roll as int16 in centi-degrees
+    #define STREAM_TYPE_TELEMETRY 0x40  ///< Health counters, STREAM_TELEMETRY_FIELDS x uint32
+    #define STREAM_TYPE_GAP 0x50     ///< Samples lost before the next sample: one of the STREAM_GAP_xxx causes and the count
+    #define STREAM_TYPE_CAPTURE 0x60 ///< Start of a capture burst: pre-trigger and post-trigger samples and gap
+    #define STREAM_TYPE_EVENT 0x70   ///< Event of the acquisition: one of the STREAM_EVENT_xxx codes and a value
+    #define STREAM_TYPE_FEATURES 0x80   ///< Features of a window: mean, RMS, min, max, peak to peak and crest for X, Y, Z
+    #define STREAM_TYPE_RAW 0x90    ///< Accelerometer sample: X, Y, Z as int16 in 12 bit digits
+    #define STREAM_TYPE_ACC 0xA0    ///< Accelerometer sample: X, Y, Z as int32 in mm/s^2, calibrated
+    #define STREAM_TYPE_AUX 0xB0    ///< Auxiliary ADC sample: ADC1, ADC2, ADC3 (or temperature) as int16
+    #define STREAM_TYPE_STATUS 0xD0 ///< Status: opcode of the command, result and value
+    #define STREAM_TYPE_TEST 0xE0   ///< Throughput test, the low nibble is one of the STREAM_TEST_xxx values
+    #define STREAM_TYPE_SPECTRUM 0xF0   ///< Spectrum of an axis: axis index and 8 bit logarithmic bins
+
+    #define STREAM_GAP_OVERRUN 0x01    ///< The FIFO of the sensor overflowed, the count is estimated from the data rate
+    #define STREAM_GAP_I2C 0x02        ///< The read of the samples from the FIFO failed
+
+    #define STREAM_EVENT_ACTIVE 0x01  ///< Activity detected, the samples before the event follow at the data rate in the value
+    #define STREAM_EVENT_RATE 0x02    ///< The following samples are at the data rate in the value
+    #define STREAM_EVENT_IDLE 0x03    ///< No activity, streaming stopped, the sensors run at the data rate in the value
+    #define STREAM_EVENT_CALIBRATION 0x04   ///< Step of the calibration done, the value is Calibration_GetStatus()
+    #define STREAM_EVENT_FLOW 0x05  ///< The following samples are sent with the flow control level in the value, see Acquisition.h
+
+    #define STREAM_TEST_PATTERN 0x00    ///< Sequence number followed by the known pattern
+    #define STREAM_TEST_RESULT 0x01     ///< Achieved bytes/s and baud rate as uint32
+    #define STREAM_TEST_BENCHMARK 0x02  ///< Highest processed samples/s and bus clock in Hz as uint32
+
+    /**
+    *   \brief Bytes of the pattern in a test frame, byte i is sequence + i.
+    */
+    #define STREAM_PATTERN_SIZE 12
+
+    #define STREAM_TELEMETRY_FIELDS 17  ///< Fields of the telemetry frame, see Telemetry.h
+    #define STREAM_IMPACT_FRAME_SIZE 10 ///< Header, 2 x uint16, uint32 and footer
+    #define STREAM_TILT_FRAME_SIZE 6    ///< Header, 2 x int16 and footer
+    #define STREAM_TELEMETRY_FRAME_SIZE (4 * STREAM_TELEMETRY_FIELDS + 2)  ///< Header, fields and footer
+    #define STREAM_GAP_FRAME_SIZE 5     ///< Header, cause, uint16 and footer
+    #define STREAM_CAPTURE_FRAME_SIZE 6 ///< Header, 2 x uint8, uint16 and footer
+    #define STREAM_EVENT_FRAME_SIZE 4   ///< Header, event, value and footer
+    #define STREAM_FEATURES_FRAME_SIZE 38   ///< Header, 3 x 6 x 16 bit and footer
+    #define STREAM_RAW_FRAME_SIZE 8     ///< Header, 3 x int16 and footer
+    #define STREAM_ACC_FRAME_SIZE 14    ///< Header, 3 x int32 and footer
+    #define STREAM_AUX_FRAME_SIZE 8     ///< Header, 3 x int16 and footer
+    #define STREAM_STATUS_FRAME_SIZE 5  ///< Header, opcode, result, value and footer
+    #define STREAM_PATTERN_FRAME_SIZE (STREAM_PATTERN_SIZE + 3)    ///< Header, sequence, pattern and footer
+    #define STREAM_RESULT_FRAME_SIZE 10 ///< Header, 2 x uint32 and footer
+    #define STREAM_SPECTRUM_HEADER_SIZE 2   ///< Header and axis, followed by the bins and the footer
+    #define STREAM_RAW8_HEADER_SIZE 2   ///< Header and count, followed by the samples and the footer
+
+    /**
+    *   \brief Size of the transmission ring, it must be a power of 2.
+    */
+    #define STREAM_TX_BUFFER_SIZE 256
+
+    /**
+    *   \brief Size of the reception ring, it must be a power of 2 and at most 256.
+    */
+    #define STREAM_RX_BUFFER_SIZE 64
+
+    /**
+    *   \brief Characters received between two drains of the hardware FIFO.
+    *
+    *   Below UART_Debug_RX_BUFFER_SIZE, the rest is the margin for the
+    *   latency of the SysTick handler.
+    */
+    #define STREAM_RX_TICK_CHARS 3
+
+    /**
+    *   \brief Move the queued bytes to the UART until its hardware FIFO is full.
+    *
+    *   This function never blocks and must be called as often as possible.
+    */
+    void Stream_Pump(void);
+
+    /**
+    *   \brief Number of free bytes in the transmission ring.
+    */
+    uint16_t Stream_TxFree(void);
+
+    /**
+    *   \brief Queue a complete frame, waiting for room in the ring if needed.
+    *
+    *   \param data Bytes of the frame.
+    *   \param count Number of bytes, at most STREAM_TX_BUFFER_SIZE - 1.
+    */
+    void Stream_Write(const uint8_t* data, uint8_t count);
+
+    /**
+    *   \brief Largest number of bytes waiting in the ring since the last reset.
+    */
+    uint16_t Stream_GetHighWater(void);
+
+    /**
+    *   \brief Restart the tracking of the high-water mark of the ring.
+    */
+    void Stream_ResetHighWater(void);
+
+    /**
+    *   \brief Cycles spent waiting for room in the ring, from the start.
+    */
+    uint32_t Stream_GetStallCycles(void);
+
+    /**
+    *   \brief Wait until all the queued bytes have left the hardware FIFO.
+    */
+    void Stream_Flush(void);
+
+    /**
+    *   \brief Start the SysTick that fills the reception ring.
+    *
+    *   \param char_cycles Cycles of the bus clock in a character at the baud rate in use.
+    */
+    void Stream_StartRx(uint32_t char_cycles);
+
+    /**
+    *   \brief Follow a change of the baud rate or of the bus clock.
+    *
+    *   The bytes received so far are discarded, they may be garbage.
+    *   \param char_cycles Cycles of the bus clock in a character at the new rate.
+    */
+    void Stream_RetuneRx(uint32_t char_cycles);
+
+    /**
+    *   \brief Take the oldest byte of the reception ring.
+    *
+    *   \retval 1 if a byte was available, 0 if the ring is empty.
+    */
+    uint8_t Stream_ReadRx(uint8_t* data);
+
+    /**
+    *   \brief Send the frame of one accelerometer sample.
+    *
+    *   \param channel Channel ID of the sensor.
+    *   \param axes Conversion of the X, Y and Z axis, see Calibration_Get().
+    *   \param AccData LSB and MSB of the X, Y and Z axis, as read from the sensor.
+    */
+    void Stream_SendAcc(uint8_t channel, const Calibration_Axis* axes, const uint8_t* AccData);
+
+    /**
+    *   \brief Send the frame of one accelerometer sample without conversion.
+    *
+    *   \param channel Channel ID of the sensor.
+    *   \param AccData LSB and MSB of the X, Y and Z axis, as read from the sensor.
+    */
+    void Stream_SendRaw(uint8_t channel, const uint8_t* AccData);
+
+    /**
+    *   \brief Send a frame with some accelerometer samples packed to 8 bit.
+    *
+    *   \param channel Channel ID of the sensor.
+    *   \param packed LIS3DH_PACKED_SAMPLE_SIZE bytes for every sample, see LIS3DH_PackSample().
+    *   \param count Number of samples, at most 80.
+    */
+    void Stream_SendRaw8(uint8_t channel, const uint8_t* packed, uint8_t count);
+
+    /**
+    *   \brief Send the orientation of one sample.
+    *
+    *   \param channel Channel ID of the sensor.
+    *   \param pitch Rotation around the Y axis in centi-degrees, from -9000 to 9000.
+    *   \param roll Rotation around the X axis in centi-degrees, from -18000 to 18000.
+    */
+    void Stream_SendTilt(uint8_t channel, int16_t pitch, int16_t roll);
+
+    /**
+    *   \brief Send the end of an impact.
+    *
+    *   \param channel Channel ID of the sensor.
+    *   \param peak Largest magnitude of the acceleration, in mg.
+    *   \param duration Samples above the threshold.
+    *   \param timestamp Index of the first sample above the threshold, see Impact.h.
+    */
+    void Stream_SendImpact(uint8_t channel, uint16_t peak, uint16_t duration, uint32_t timestamp);
+
+    /**
+    *   \brief Send the frame of one auxiliary ADC sample.
+    *
+    *   \param channel Channel ID of the sensor.
+    *   \param adc ADC1, ADC2 and ADC3 (or temperature) values.
+    */
+    void Stream_SendAux(uint8_t channel, const int16_t* adc);
+
+    /**
+    *   \brief Send the features of a window.
+    *
+    *   \param channel Channel ID of the sensor.
+    *   \param features Features of the X, Y and Z axis.
+    */
+    void Stream_SendFeatures(uint8_t channel, const Features_Axis* features);
+
+    /**
+    *   \brief Send a telemetry frame.
+    *
+    *   \param fields STREAM_TELEMETRY_FIELDS values, sent LSB first.
+    */
+    void Stream_SendTelemetry(const uint32_t* fields);
+
+    /**
+    *   \brief Send a gap marker.
+    *
+    *   \param channel Channel ID of the sensor.
+    *   \param cause One of the STREAM_GAP_xxx causes.
+    *   \param lost Number of samples lost, saturated to 65535.
+    */
+    void Stream_SendGap(uint8_t channel, uint8_t cause, uint32_t lost);
+
+    /**
+    *   \brief Send the header of a capture burst.
+    *
+    *   The STREAM_TYPE_RAW frames of the pre-trigger and then of the
+    *   post-trigger samples follow.
+    *   \param channel Channel ID of the sensor.
+    *   \param pre Number of samples before the trigger.
+    *   \param post Number of samples of the post-trigger window.
+    *   \param gap_us Time between the two blocks, in us.
+    */
+    void Stream_SendCapture(uint8_t channel, uint8_t pre, uint8_t post, uint16_t gap_us);
+
+    /**
+    *   \brief Send an event of the acquisition.
+    *
+    *   \param channel Channel ID of the sensor, 0 for the events of all the sensors.
+    *   \param event One of the STREAM_EVENT_xxx codes.
+    *   \param value Value of the event.
+    */
+    void Stream_SendEvent(uint8_t channel, uint8_t event, uint8_t value);
+
+    /**
+    *   \brief Send a status frame in reply to a command.
+    *
+    *   \param opcode Opcode of the command.
+    *   \param result Result of the command, 0 if accepted.
+    *   \param value Value of the setting after the command.
+    */
+    void Stream_SendStatus(uint8_t opcode, uint8_t result, uint8_t value);
+
+    /**
+    *   \brief Send the spectrum of an axis.
+    *
+    *   \param channel Channel ID of the sensor.
+    *   \param axis 0 for X, 1 for Y, 2 for Z.
+    *   \param bins Logarithmic magnitudes, see Spectrum.h.
+    *   \param count Number of bins, at most 250.
+    */
+    void Stream_SendSpectrum(uint8_t channel, uint8_t axis, const uint8_t* bins, uint8_t count);
+
+    /**
+    *   \brief Send a frame of the throughput test pattern.
+    *
+    *   \param sequence Sequence number of the frame.
+    */
+    void Stream_SendPattern(uint8_t sequence);
+
+    /**
+    *   \brief Send the result of the throughput test.
+    *
+    *   \param bytes_per_s Achieved throughput.
+    *   \param baud Baud rate of the test.
+    */
+    void Stream_SendThroughput(uint32_t bytes_per_s, uint32_t baud);
+
+    /**
+    *   \brief Send the result of the benchmark of the processing.
+    *
+    *   \param samples_per_s Highest sample rate the processing could sustain.
+    *   \param clock_hz Bus clock of the benchmark.
+    */
+    void Stream_SendBenchmark(uint32_t samples_per_s, uint32_t clock_hz);
+
+#endif
+/* [] END OF FILE */
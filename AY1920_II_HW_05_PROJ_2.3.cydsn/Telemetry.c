@@ -0,0 +1,102 @@
+/*
+* This file includes the source code of the periodic
+* telemetry frame.
+*/
+
+#include "Telemetry.h"
+#include "Acquisition.h"
+#include "I2C_Interface.h"
+#include "Latency.h"
+#include "Stream.h"
+#include "Timing.h"
+
+static uint32_t period;         // Period of the frames in us, 0 if stopped
+static uint32_t period_start;   // Microsecond time base at the beginning of the period
+static uint32_t loop_cycles;    // Cycles of the iterations in the period
+static uint32_t idle_cycles;    // Cycles of the iterations that only waited for the bus
+static uint32_t loop_max;       // Longest iteration in the period
+static uint32_t busy_total;     // Cycles of the iterations that did some work, from the start
+
+/**
+*   \brief Clear the counters of the period.
+*/
+static void Telemetry_Restart(void)
+{
+    period_start = Timing_NowUs();
+    loop_cycles = 0;
+    idle_cycles = 0;
+    loop_max = 0;
+    Stream_ResetHighWater();
+    Latency_Reset();
+}
+
+/**
+*   \brief Collect the counters and send the frame.
+*/
+static void Telemetry_Send(void)
+{
+    Acquisition_Stats acq;
+    const I2C_Stats* i2c = I2C_Peripheral_GetStats();
+    uint32_t fields[STREAM_TELEMETRY_FIELDS];
+
+    Acquisition_GetStats(&acq);
+
+    fields[0] = acq.acquired;
+    fields[1] = acq.sent;
+    fields[2] = acq.lost_overrun;
+    fields[3] = acq.lost_i2c;
+    fields[4] = i2c->nak_errors + i2c->timeouts;
+    fields[5] = i2c->retries;
+    fields[6] = i2c->failures;
+    fields[7] = Stream_GetHighWater();
+    fields[8] = loop_max;
+    fields[9] = (loop_cycles != 0) ? (uint32_t)(((uint64_t)idle_cycles * 1000) / loop_cycles) : 0;
+    fields[10] = acq.shed;
+    fields[11] = acq.encode_cycles;
+    Latency_Get(&fields[12], &fields[12 + LATENCY_SOURCES]);
+
+    Stream_SendTelemetry(fields);
+}
+
+void Telemetry_Start(void)
+{
+    Telemetry_SetPeriod(TELEMETRY_PERIOD_DEFAULT);
+}
+
+void Telemetry_SetPeriod(uint8_t units)
+{
+    period = (uint32_t)units * TELEMETRY_UNIT_US;   // In us, so it holds across a change of the clock
+    Telemetry_Restart();
+}
+
+void Telemetry_Loop(uint32_t loop_start, uint8_t busy)
+{
+    uint32_t cycles = Timing_Elapsed(loop_start);
+
+    loop_cycles += cycles;
+    if (!busy)
+    {
+        idle_cycles += cycles;
+    }
+    else
+    {
+        busy_total += cycles;
+    }
+    if (cycles > loop_max)
+    {
+        loop_max = cycles;
+    }
+
+    if (period != 0 && Timing_NowUs() - period_start >= period)
+    {
+        Telemetry_Send();
+        Telemetry_Restart();
+    }
+}
+
+uint32_t Telemetry_GetBusyCycles(void)
+{
+    return busy_total;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,73 @@
+/**
+*   \file Telemetry.h
+*   \brief Periodic telemetry frame with the health counters of the firmware.
+*
+*   The STREAM_TYPE_TELEMETRY frame carries, as uint32:
+*   - 0: samples read from the FIFOs
+*   - 1: samples given to the output format, after the decimation
+*   - 2: samples lost by the FIFOs of the sensors (estimated)
+*   - 3: samples lost by failed I2C reads
+*   - 4: I2C attempts failed by NAK, bus error or timeout
+*   - 5: I2C attempts repeated
+*   - 6: I2C transactions failed after all the retries
+*   - 7: high-water mark of the UART ring in the period, in bytes
+*   - 8: longest iteration of the main loop in the period, in cycles
+*   - 9: fraction of the period spent waiting for the bus, in thousandths
+*   - 10: samples not sent by the flow control of the acquisition
+*   - 11: cycles spent encoding the samples without the UART stalls, wrapping at 2^32
+*   - 12 to 15: longest entry delay of the I2C, UART, INT1 and timer
+*     interrupts in the period, in cycles
+*   - 16: longest run of the I2C ISR in the period, in cycles
+*
+*   The fields from 0 to 6, 10 and 11 count from the start, the host
+*   computes the differences; the fields from 7 to 9 and from 12 to 16
+*   refer to the period of the frame. The fields from 12 to 16 are 0 unless
+*   LATENCY_MEASURE is set, see Latency.h. The differences of field 11 over field 0 are the cycles
+*   per sample of the encoding, see RamCode.h.
+*
+*   \author Simone Fiorani
+*   \date 2020
+*/
+
+#ifndef __TELEMETRY_H
+    #define __TELEMETRY_H
+
+    #include "cytypes.h"
+
+    /**
+    *   \brief Unit of the period of the telemetry, in us.
+    */
+    #define TELEMETRY_UNIT_US 100000
+
+    /**
+    *   \brief Default period of the telemetry, in units (1 s).
+    */
+    #define TELEMETRY_PERIOD_DEFAULT 10
+
+    /**
+    *   \brief Start the telemetry with the default period.
+    */
+    void Telemetry_Start(void);
+
+    /**
+    *   \brief Change the period of the telemetry.
+    *
+    *   \param units Period in units of TELEMETRY_UNIT_US, 0 to stop the telemetry.
+    */
+    void Telemetry_SetPeriod(uint8_t units);
+
+    /**
+    *   \brief Account an iteration of the main loop and send the frame when the period expires.
+    *
+    *   \param loop_start Value of Timing_Now() at the beginning of the iteration.
+    *   \param busy 0 if the iteration only waited for the bus.
+    */
+    void Telemetry_Loop(uint32_t loop_start, uint8_t busy);
+
+    /**
+    *   \brief Cycles of the iterations that did some work, from the start, wrapping at 2^32.
+    */
+    uint32_t Telemetry_GetBusyCycles(void);
+
+#endif
+/* [] END OF FILE */
@@ -0,0 +1,51 @@
+/*
+* This file includes the source code of the time base
+* based on the DWT cycle counter.
+*/
+
+#include "Timing.h"
+#include "RamCode.h"
+#include "core_cm3_psoc5.h"
+
+static uint32_t base_us;        // Microseconds counted up to base_cycles
+static uint32_t base_cycles;    // Cycle counter at the last whole microsecond counted
+
+void Timing_Start(void)
+{
+    // The trace block must be enabled to make the DWT count
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    base_us = 0;
+    base_cycles = 0;
+}
+
+RAM_CODE uint32_t Timing_Now(void)
+{
+    return DWT->CYCCNT;
+}
+
+RAM_CODE uint32_t Timing_Elapsed(uint32_t since)
+{
+    return DWT->CYCCNT - since;
+}
+
+uint32_t Timing_NowUs(void)
+{
+    uint32_t cycles_per_us = TIMING_CYCLES_PER_US;
+    uint32_t us = (DWT->CYCCNT - base_cycles) / cycles_per_us;
+
+    // The fraction of microsecond left is counted at the next call
+    base_us += us;
+    base_cycles += us * cycles_per_us;
+
+    return base_us;
+}
+
+void Timing_Rebase(void)
+{
+    base_cycles = DWT->CYCCNT;
+}
+
+/* [] END OF FILE */
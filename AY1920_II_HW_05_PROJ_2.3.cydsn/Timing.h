@@ -0,0 +1,70 @@
+/**
+*   \file Timing.h
+*   \brief Time base based on the cycle counter of the Cortex-M3.
+*
+*   The DWT cycle counter runs at the bus clock and is used to enforce the
+*   deadlines of the non blocking operations and to measure the code.
+*   Intervals are computed as unsigned differences, so they are correct
+*   across the wrap of the counter as long as they are shorter than 2^32
+*   cycles (about 178 s at 24 MHz, 67 s at 64 MHz).
+*
+*   The deadlines that must hold across a change of the clock profile
+*   (periods set by the host, timeouts of the command channel) use the
+*   microsecond time base instead: Timing_NowUs() counts the whole
+*   microseconds elapsed at the clock in use, and Clock_SetProfile() folds
+*   the cycles of the old clock into it before switching. It must be
+*   called at least once every 2^32 cycles, the main loop does.
+*
+*   \author Simone Fiorani
+*   \date 2020
+*/
+
+#ifndef __TIMING_H
+    #define __TIMING_H
+
+    #include "cytypes.h"
+    #include "Clock.h"
+
+    /**
+    *   \brief Cycles of the counter in one microsecond, it follows the clock profile.
+    */
+    #define TIMING_CYCLES_PER_US ((uint32_t)Clock_GetMHz())
+
+    /**
+    *   \brief Convert microseconds to cycles of the counter.
+    */
+    #define TIMING_US_TO_CYCLES(us) ((uint32_t)(us) * TIMING_CYCLES_PER_US)
+
+    /**
+    *   \brief Start the cycle counter.
+    */
+    void Timing_Start(void);
+
+    /**
+    *   \brief Current value of the cycle counter.
+    */
+    uint32_t Timing_Now(void);
+
+    /**
+    *   \brief Cycles elapsed since a previous value of the counter.
+    *   \param since Value returned by Timing_Now().
+    */
+    uint32_t Timing_Elapsed(uint32_t since);
+
+    /**
+    *   \brief Microseconds since Timing_Start(), wrapping at 2^32 (71 minutes).
+    *
+    *   Not reentrant, only called from the main loop.
+    */
+    uint32_t Timing_NowUs(void);
+
+    /**
+    *   \brief Restart the count of the microseconds from the current cycle.
+    *
+    *   Called by Clock_SetProfile() after the switch, Timing_NowUs() having
+    *   been called just before it.
+    */
+    void Timing_Rebase(void);
+
+#endif
+/* [] END OF FILE */
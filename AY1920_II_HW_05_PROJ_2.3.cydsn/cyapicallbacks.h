@@ -16,6 +16,18 @@
     /*Define your macro callbacks here */
     /*For more information, refer to the Writing Code topic in the PSoC Creator Help.*/
 
+    /* 1 to measure the entry delay of the interrupts, see Latency.h */
+    #ifndef LATENCY_MEASURE
+        #define LATENCY_MEASURE 0
+    #endif
+
+    #if LATENCY_MEASURE
+        #define I2C_Master_ISR_ENTRY_CALLBACK
+        void I2C_Master_ISR_EntryCallback(void);
+        #define I2C_Master_ISR_EXIT_CALLBACK
+        void I2C_Master_ISR_ExitCallback(void);
+    #endif
+
     
 #endif /* CYAPICALLBACKS_H */   
 /* [] */
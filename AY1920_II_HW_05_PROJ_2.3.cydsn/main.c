@@ -5,45 +5,44 @@
 * to read data from the LIS3DH accelerometer through a multiread.
 * In this section we want to read the data in acceleration units, so m/s^2.
 *
+* Up to two LIS3DH can share the bus (SA0 low at 0x18, SA0 high at 0x19).
+* Each sensor buffers its samples in the FIFO and the acquisition
+* pipeline drains them in turn, tagging every frame with the channel ID
+* of the sensor. The temperature and the auxiliary ADC are read at a
+* lower rate, only when the FIFOs have been emptied, and share the same
+* stream.
+*
+* The interrupts follow the priority plan of Latency.h, so that the
+* completion of the I2C transfers is never delayed by the other handlers.
+*
+* Every sensor found runs its built-in self-test at boot, the result is
+* printed and sent as a status frame.
+*
+* ODR, full scale range, batching and format of the frames can be changed
+* at runtime with the binary commands described in Command.h.
+*
+* The accelerometer frames are corrected with the offset and gain of every
+* axis, measured with the 6-position calibration described in Calibration.h.
+*
 * \author Simone Fiorani
 * \date , 2020
 */
 
 // Include required header files
 #include "I2C_Interface.h"
+#include "LIS3DH.h"
+#include "Acquisition.h"
+#include "Baud.h"
+#include "Calibration.h"
+#include "Command.h"
+#include "Print.h"
+#include "SelfTest.h"
+#include "Stream.h"
+#include "Telemetry.h"
+#include "Timing.h"
 #include "project.h"
-#include "stdio.h"
 #include "InterruptRoutines.h"
-
-/**
-*   \brief 7-bit I2C address of the slave device.
-*/
-#define LIS3DH_DEVICE_ADDRESS 0x18
-
-/**
-*   \brief Address of the WHO AM I register
-*/
-#define LIS3DH_WHO_AM_I_REG_ADDR 0x0F
-
-/**
-*   \brief Address of the Status register
-*/
-#define LIS3DH_STATUS_REG 0x27
-
-/**
-*   \brief Address of the Control register 1
-*/
-#define LIS3DH_CTRL_REG1 0x20
-
-/**
-*   \brief Address of the Control register 4
-*/
-#define LIS3DH_CTRL_REG4 0x23
-
-/**
-*   \brief Address of the Xaxis output LSB register. It will be the first accelerometer register to be read in the multiread
-*/
-#define LIS3DH_X_AXIS_L 0x28
+#include "Latency.h"
 
 /**
 *   \brief Hex value to set normal mode, 100 Hz in CTRL_REG_1
@@ -55,22 +54,18 @@
 */
 #define LIS3DH_HIGH_RES_MODE_4G_CTRL_REG_4 0x98
 
-
 /******************************************/
 
-
 int main(void)
 {
     CyGlobalIntEnable; /* Enable global interrupts. */
-    
+
     I2C_Peripheral_Start(); // Start of the I2C
     UART_Debug_Start();     // Start of UART
-    
-    
+    Baud_Start();           // Commands received in the background
+    Latency_Start();        // Priorities of the interrupts, the I2C first
+
     CyDelay(5); //"The boot procedure is complete about 5 milliseconds after device power-up."
-    
-    // String to print out messages on the UART
-    char message[50];
 
     // Check which devices are present on the I2C bus
     for (int i = 0 ; i < 128; i++)
@@ -78,215 +73,114 @@ int main(void)
         if (I2C_Peripheral_IsDeviceConnected(i))
         {
             // print out the address is hex format
-            sprintf(message, "Device 0x%02X is connected\r\n", i);
-            UART_Debug_PutString(message); 
+            Print_String("Device 0x");
+            Print_Hex(i, 2);
+            Print_String(" is connected\r\n");
         }
-        
-    }
-    
-    /******************************************/
-    /*            I2C Reading                 */
-    /******************************************/
-    
-    /* Read WHO AM I REGISTER register */
-    uint8_t who_am_i_reg;
-    
-    ErrorCode error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                                  LIS3DH_WHO_AM_I_REG_ADDR, 
-                                                  &who_am_i_reg);
-    if (error == NO_ERROR)
-    {
-        sprintf(message, "WHO AM I REG: 0x%02X [Expected: 0x33]\r\n", who_am_i_reg);
-        UART_Debug_PutString(message); 
-    }
-    else
-    {
-        UART_Debug_PutString("Error occurred during I2C comm\r\n");   
-    }
-    
-    /******************************************/
-    /*      I2C Reading Status Register       */
-    /******************************************/
-    
-    uint8_t status_register; 
-    
-    error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                        LIS3DH_STATUS_REG,
-                                        &status_register);
-    
-    if (error == NO_ERROR)
-    {
-        sprintf(message, "STATUS REGISTER: 0x%02X\r\n", status_register);
-        UART_Debug_PutString(message); 
-    }
-    else
-    {
-        UART_Debug_PutString("Error occurred during I2C comm to read status register\r\n");   
+
     }
-    
+
     /******************************************/
-    /*            I2C Writing                 */
+    /*          Sensors configuration         */
     /******************************************/
-    
-    uint8_t ctrl_reg1;
-    
-    if (ctrl_reg1 != LIS3DH_NORMAL_MODE_100HZ_CTRL_REG_1)
+
+    const uint8_t addresses[LIS3DH_MAX_DEVICES] = { LIS3DH_DEVICE_ADDRESS, LIS3DH_DEVICE_ADDRESS_SA0 };
+    LIS3DH_Handle sensors[LIS3DH_MAX_DEVICES];
+    uint8_t sensor_count = 0;
+
+    for (uint8_t i = 0; i < LIS3DH_MAX_DEVICES; i++)
     {
-        ctrl_reg1 = LIS3DH_NORMAL_MODE_100HZ_CTRL_REG_1; // We set the 100 Hz, normal mode to sample the accelerometer data
-    
-        error = I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS,
-                                             LIS3DH_CTRL_REG1,
-                                             ctrl_reg1);
-    
+        /* Read WHO AM I REGISTER register */
+        uint8_t who_am_i_reg;
+
+        ErrorCode error = I2C_Peripheral_ReadRegister(addresses[i],
+                                                      LIS3DH_WHO_AM_I_REG_ADDR,
+                                                      &who_am_i_reg);
+        if (error != NO_ERROR || who_am_i_reg != LIS3DH_WHO_AM_I_VALUE)
+        {
+            continue;   // No accelerometer at this address
+        }
+
+        Print_String("LIS3DH 0x");
+        Print_Hex(addresses[i], 2);
+        Print_String(": channel ");
+        Print_Dec(sensor_count);
+        Print_String("\r\n");
+
+        LIS3DH_Handle* dev = &sensors[sensor_count];
+
+        error = LIS3DH_Init(dev, addresses[i], sensor_count);  // All the control registers are read in two bursts and cached,
+                                                               //      so the configuration below doesn't need any read from the bus
+
+        LIS3DH_SetRegister(dev, LIS3DH_CTRL_REG1, LIS3DH_NORMAL_MODE_100HZ_CTRL_REG_1); // We set the 100 Hz, normal mode to sample the accelerometer data
+
+        LIS3DH_SetRegister(dev, LIS3DH_CTRL_REG4, LIS3DH_HIGH_RES_MODE_4G_CTRL_REG_4);  // We set the high resolution (12 bit value), +-4g mode and the BDU active,
+                                                                                        // so the data won't be uploaded, until both LSB and MSB of the registers have been read
+
+        LIS3DH_SetFifoMode(dev, LIS3DH_FIFO_MODE_STREAM);  // Samples are buffered in the FIFO while the other sensor is drained
+
+        LIS3DH_EnableAux(dev, 1);   // ADC1 and ADC2 plus the temperature sensor on the third channel
+
         if (error == NO_ERROR)
         {
-            sprintf(message, "CONTROL REGISTER 1 successfully written as: 0x%02X\r\n", ctrl_reg1);
-            UART_Debug_PutString(message); 
+            error = LIS3DH_Commit(dev); // Only the registers that really changed are written, grouped in bursts
+        }
+
+        if (error == NO_ERROR)
+        {
+            Print_String("CONTROL REGISTER 1 successfully written as: 0x");
+            Print_Hex(LIS3DH_GetRegister(dev, LIS3DH_CTRL_REG1), 2);
+            Print_String("\r\nCONTROL REGISTER 4 successfully written as: 0x");
+            Print_Hex(LIS3DH_GetRegister(dev, LIS3DH_CTRL_REG4), 2);
+            Print_String("\r\n");
+
+            // The self-test moves every axis by a known amount, a broken sensor is reported
+            //      before the acquisition starts, but it's still acquired
+            int16_t delta[3];
+            error = SelfTest_Run(dev, delta);
+
+            Print_String("Self-test X Y Z [mg]:");
+            for (uint8_t axis = 0; axis < 3; axis++)
+            {
+                Print_String(" ");
+                Print_Dec(delta[axis]);
+            }
+            Print_String((error == NO_ERROR) ? " PASS\r\n" : " FAIL\r\n");
+
+            Stream_SendStatus(COMMAND_SENSOR_TEST,
+                              (error == NO_ERROR) ? COMMAND_STATUS_OK : COMMAND_STATUS_FAILED,
+                              dev->channel);
+            sensor_count++;
         }
         else
         {
-            UART_Debug_PutString("Error occurred during I2C comm to set control register 1\r\n");   
+            Print_String("Error occurred during I2C comm to set control registers\r\n");
         }
     }
-    
-    
-    /******************************************/
-    /*         Read Control Register 1        */
-    /******************************************/
 
-    error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                        LIS3DH_CTRL_REG1,
-                                        &ctrl_reg1);
-    
-    if (error == NO_ERROR)
-    {
-        sprintf(message, "CONTROL REGISTER 1 after overwrite operation: 0x%02X\r\n", ctrl_reg1);
-        UART_Debug_PutString(message); 
-    }
-    else
+    if (sensor_count == 0)
     {
-        UART_Debug_PutString("Error occurred during I2C comm to read control register 1\r\n");   
+        Print_String("No LIS3DH found on the bus\r\n");
     }
-    
-    /******************************************/
-    /*          Set Control Register 4        */
-    /******************************************/
-    
-    uint8_t ctrl_reg4;
-
-    ctrl_reg4 = LIS3DH_HIGH_RES_MODE_4G_CTRL_REG_4; // We set the high resolution (12 bit value), +-4g mode and the BDU active,
-                                                    // so the data won't be uploaded, until both LSB and MSB of the registers have been read
-    
-    error = I2C_Peripheral_WriteRegister(LIS3DH_DEVICE_ADDRESS,
-                                         LIS3DH_CTRL_REG4,
-                                         ctrl_reg4);
-    
-    error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,
-                                        LIS3DH_CTRL_REG4,
-                                        &ctrl_reg4);
-    
-    
-    if (error == NO_ERROR)
-    {
-        sprintf(message, "CONTROL REGISTER 4 after being updated: 0x%02X\r\n", ctrl_reg4);
-        UART_Debug_PutString(message); 
-    }
-    else
-    {
-        UART_Debug_PutString("Error occurred during I2C comm to read control register4\r\n");   
-    }
-    
+
     /******************************************/
     /*   Reading of the 3 Axis Accelerometer  */
     /******************************************/
-    
-    
-    uint8_t StatusReg;      // Reading of the StatusReg to check if new data is available
-    int16_t OutTemp;        // Variable containing the actual, int16, data of the i-Axis accelerometer that will be sent to UART
-    uint8_t header = 0xA0;  // Header of the UART string
-    uint8_t footer = 0xC0;  // Footer of the UART string
-    uint8_t OutArray[14];   // The final packet sent by UART
-    uint8_t AccData[6];     // Array containig the accelerometer data in this order: LSB and MSB of the X,Y and then Z axis
-    
-    float Xaxis_Acc;        // Value of the acceleration after the conversion
-    float Yaxis_Acc;        //      from the int16 value in mg to the float
-    float Zaxis_Acc;        //      value in m/s^2 of the X,Y and Z axis
-    
-    int32 Xaxis_OUT;        // Value of the acceleration in m/s^2 convertedin int32.
-    int32 Yaxis_OUT;        //      This must be done, because in the bridge control
-    int32 Zaxis_OUT;        //      panel is easier to manage an int than a float
-    
-    OutArray[0] = header;   // First byte of the string is the header
-    OutArray[13] = footer;   // Last byte of the string is the footer
-    
-//    isr_READ_StartEx(Custom_ISR_READ);  // Starting the ISR that rise the flag enabling the accelerometer reading
-//    Timer_ACC_Start();                  // Timer that generates the ISR at 100 Hz, in order to have a constant reading rate
-     
+
+    Calibration_Start();    // Offset and gain of the axes stored in flash, if any
+    Acquisition_Start(sensors, sensor_count);
+    Telemetry_Start();
+
     for(;;)
     {
-//        if (FlagREAD == 1) // If the timer has generated the interrupt
-//        {
-            error = I2C_Peripheral_ReadRegister(LIS3DH_DEVICE_ADDRESS,  // Read the content of the status reg. We want to control
-                                                LIS3DH_STATUS_REG,      // the bit ZYXDA (bit 3), that it's 1 when a new set of data is
-                                                &StatusReg);            // available. BDU active ensure that the data of the register
-                                                                        // won't be updated until the reading is done
-                                                                        
-            if ( (StatusReg & 0x08) == 0x08 ) // If bit ZYXDA is high (new data available)
-            {
-                error = I2C_Peripheral_ReadRegisterMulti(LIS3DH_DEVICE_ADDRESS, // Read the content of the registers of the accelerometer.
-                                                         LIS3DH_X_AXIS_L,       // Starting the reading from the first register (LSB of X axis)
-                                                         6,                     // We have 6 register to be read (LSB and MSB for the 3 axis).
-                                                         &AccData[0]);          // The content saved in the array AccData in X,Y,Z order
-                
-                if(error == NO_ERROR)   // If reading completed without errors
-                {
-                                       
-                    OutTemp = (int16)((AccData[0] | (AccData[1]<<8)))>>4;   // LSB and MSB of the reading form an int16. The 4 bit shift is done
-                                                                            //      in order to right-align the 12bit left-align value received from the accelerometer
-                    
-                    
-                    Xaxis_Acc = OutTemp * 2 * 9.806 * 0.001;    // We multiply the value for the sensitivity (2) and the gravity acceleration (9.806)
-                                                                //      converted from m/s^2 to mm/s^2 (from the accelerometer we received values in mg, not g
-                    
-                    Xaxis_OUT = Xaxis_Acc * 1000;               // We create an int32 from the float value, multiplied for 1000 to keep 3 digit after comma in the truncation to an integer
-                    
-                    OutArray[1] = (uint8_t)(Xaxis_OUT & 0xFF);  // Separation of the int32 in the 4 byte that will be sent
-                    OutArray[2] = (uint8_t)(Xaxis_OUT >> 8);    //      to the UART. The order il LSB - MSB
-                    OutArray[3] = (uint8_t)(Xaxis_OUT >> 16);
-                    OutArray[4] = (uint8_t)(Xaxis_OUT >> 24);
-                    
-                    OutTemp = (int16)((AccData[2] | (AccData[3]<<8)))>>4;   // Repetition of the reading procedure for Y axis
-                    
-                    Yaxis_Acc = OutTemp * 9.806 * 0.001 * 2;
-                    
-                    Yaxis_OUT = Yaxis_Acc * 1000;
-                    
-                    OutArray[5] = (uint8_t)(Yaxis_OUT & 0xFF);
-                    OutArray[6] = (uint8_t)(Yaxis_OUT >> 8);
-                    OutArray[7] = (uint8_t)(Yaxis_OUT >> 16);
-                    OutArray[8] = (uint8_t)(Yaxis_OUT >> 24);
-                    
-                    OutTemp = (int16)((AccData[4] | (AccData[5]<<8)))>>4;   // Repetition of the reading procedure for Z axis
-                    
-                    Zaxis_Acc = OutTemp * 9.806 * 0.001 * 2;
-                    
-                    Zaxis_OUT = Zaxis_Acc * 1000;
-                    
-                    OutArray[9] = (uint8_t) (Zaxis_OUT & 0xFF);
-                    OutArray[10] = (uint8_t)(Zaxis_OUT >> 8);
-                    OutArray[11] = (uint8_t)(Zaxis_OUT >> 16);
-                    OutArray[12] = (uint8_t)(Zaxis_OUT >> 24);
-                    
-                    UART_Debug_PutArray(OutArray, 14);// Sending of the complete string through UART
-                    
-//                    FlagREAD = 0; // Setting again the flag to zero, waiting a new interrupt from timer
-                    
-                    
-
-                }
-            }
-        }
+        uint32_t loop_start = Timing_Now();
+
+        uint8_t busy = Acquisition_Task();  // I2C drains and UART transmission overlap in the ping-pong pipeline
+        Command_Task();                     // Settings received through UART are applied at the end of the round
+        Latency_Task();                     // Probe of the interrupt latency, only with LATENCY_MEASURE
+
+        Telemetry_Loop(loop_start, busy);   // Health counters of the pipeline, sent once per period
     }
-//}
+}
 
 /* [] END OF FILE */
@@ -0,0 +1,358 @@
+/*
+* This file includes a host simulation of the drain of the FIFOs,
+* to compare the throughput of the ping-pong pipeline of
+* Acquisition_Task() with the sequential loop.
+*
+* Build and run from this folder with `make bench`, or:
+*   gcc -std=gnu99 -O2 -DRAM_CODE_ENABLE=0 -Ihost -I../AY1920_II_HW_05_PROJ_2.3.cydsn
+*       acq_bench.c ../AY1920_II_HW_05_PROJ_2.3.cydsn/{Acquisition,LIS3DH,Filter,FixedMath,
+*       Features,Spectrum,Impact,Motion}.c -lm -o acq_bench && ./acq_bench
+*
+* The real Acquisition and LIS3DH modules run against stubs of the
+* components: a virtual cycle counter at 24 MHz, sensors whose FIFOs fill
+* at their data rate, an I2C bus at I2C_Master_DATA_RATE that takes 9 bit
+* times per byte and a stream that charges a fixed number of cycles for
+* every sample encoded. The sequential loop is the same code with every
+* transfer completed before StartReadRegisterMulti returns, so the CPU
+* waits for the bus instead of encoding meanwhile.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "Acquisition.h"
+#include "Calibration.h"
+#include "Capture.h"
+#include "Clock.h"
+#include "I2C_Interface.h"
+#include "Timing.h"
+
+#define BENCH_MHZ 24                    // Clock of the design
+#define BENCH_SECONDS 2                 // Simulated time of every run
+#define BENCH_LOOP_CYCLES 60            // Main loop around Acquisition_Task(), Poll included
+#define BENCH_EVENT_CYCLES 200          // Frames that are not samples (gap, aux, event)
+
+// Bits on the bus for every byte, data plus acknowledge
+#define BENCH_BYTE_CYCLES (9u * BENCH_MHZ * 1000000u / (I2C_Master_DATA_RATE * 1000u))
+
+/**
+*   \brief Load of a run, the bus must be able to carry it.
+*/
+typedef struct {
+    uint8_t sensors;    // Sensors drained in turn
+    uint8_t odr;        // Data rate of all the sensors, one of the LIS3DH_ODR_xxx values
+    uint16_t odr_hz;    // Same data rate in Hz
+} BenchScenario;
+
+static const BenchScenario scenarios[] = {
+    { 1, LIS3DH_ODR_1344HZ, 1344 },
+    { 2, LIS3DH_ODR_400HZ, 400 },
+};
+
+static const uint8_t addresses[LIS3DH_MAX_DEVICES] = { 0x18, 0x19 };
+
+static uint64_t now;                // Virtual cycle counter
+static uint8_t sequential;          // Set to complete every transfer at once
+static uint64_t done_at;            // End of the transfer in progress
+static uint32_t sample_cycles;      // Cost of the encoding of a sample
+static const BenchScenario* load;   // Scenario being run
+
+static uint64_t produced[LIS3DH_MAX_DEVICES];   // Samples read out of every FIFO, or overwritten
+static uint64_t overwritten;                    // Samples lost by the FIFOs
+static uint64_t encoded;                        // Samples handed to the stream
+
+/**
+*   \brief Bring the FIFO of a sensor to a point in time and return its level.
+*/
+static uint8_t Bench_FifoLevel(uint8_t s, uint64_t at)
+{
+    uint64_t total = at * load->odr_hz / (BENCH_MHZ * 1000000u);
+    uint64_t level = total - produced[s];
+
+    if (level > LIS3DH_FIFO_SIZE)
+    {
+        overwritten += level - LIS3DH_FIFO_SIZE;
+        produced[s] += level - LIS3DH_FIFO_SIZE;
+        level = LIS3DH_FIFO_SIZE;
+    }
+    return (uint8_t)level;
+}
+
+/**
+*   \brief Read registers of a sensor, the result is valid at the end of the transfer.
+*/
+static uint64_t Bench_Read(uint8_t address, uint8_t reg, uint8_t count, uint8_t* data)
+{
+    uint64_t end = now + (3u + count) * BENCH_BYTE_CYCLES;   // Address, register, address again and data
+    uint8_t s = address - addresses[0];
+
+    memset(data, 0, count);
+    if (s < load->sensors && reg == LIS3DH_FIFO_SRC_REG)
+    {
+        uint8_t level = Bench_FifoLevel(s, end);
+
+        data[0] = (level == LIS3DH_FIFO_SIZE) ? LIS3DH_FIFO_SRC_OVRN : (uint8_t)level;
+        if (level == 0)
+        {
+            data[0] |= LIS3DH_FIFO_SRC_EMPTY;
+        }
+    }
+    else if (s < load->sensors && reg == LIS3DH_X_AXIS_L)
+    {
+        Bench_FifoLevel(s, now);
+        produced[s] += count / LIS3DH_SAMPLE_SIZE;
+    }
+    return end;
+}
+
+// Components used by the acquisition
+
+uint32_t Timing_Now(void)
+{
+    return (uint32_t)now;
+}
+
+uint32_t Timing_Elapsed(uint32_t since)
+{
+    return (uint32_t)now - since;
+}
+
+uint8_t Clock_GetMHz(void)
+{
+    return BENCH_MHZ;
+}
+
+uint32_t Clock_GetHz(void)
+{
+    return BENCH_MHZ * 1000000u;
+}
+
+ErrorCode Clock_Check(uint8_t profile)
+{
+    return profile == CLOCK_PROFILE_24MHZ ? NO_ERROR : ERROR;
+}
+
+ErrorCode Clock_SetProfile(uint8_t profile)
+{
+    return Clock_Check(profile);
+}
+
+ErrorCode I2C_Peripheral_ReadRegister(uint8_t device_address, uint8_t register_address, uint8_t* data)
+{
+    now = Bench_Read(device_address, register_address, 1, data);
+    return NO_ERROR;
+}
+
+ErrorCode I2C_Peripheral_ReadRegisterMulti(uint8_t device_address, uint8_t register_address,
+                                           uint8_t register_count, uint8_t* data)
+{
+    now = Bench_Read(device_address, register_address, register_count, data);
+    return NO_ERROR;
+}
+
+ErrorCode I2C_Peripheral_WriteRegisterMulti(uint8_t device_address, uint8_t register_address,
+                                            uint8_t register_count, uint8_t* data)
+{
+    now += (2u + register_count) * BENCH_BYTE_CYCLES;
+    return NO_ERROR;
+}
+
+ErrorCode I2C_Peripheral_StartReadRegisterMulti(uint8_t device_address, uint8_t register_address,
+                                                uint8_t register_count, uint8_t* data)
+{
+    done_at = Bench_Read(device_address, register_address, register_count, data);
+    if (sequential)
+    {
+        now = done_at;
+    }
+    return NO_ERROR;
+}
+
+uint8_t I2C_Peripheral_Poll(ErrorCode* result)
+{
+    *result = NO_ERROR;
+    return now < done_at;
+}
+
+const Calibration_Axis* Calibration_Get(uint8_t channel, uint8_t sensitivity)
+{
+    return NULL;
+}
+
+void Calibration_Convert(const Calibration_Axis* axes, const uint8_t* AccData, int32_t* acc)
+{
+}
+
+ErrorCode Calibration_Measure(LIS3DH_Handle* sensors, uint8_t sensor_count, uint8_t position)
+{
+    return NO_ERROR;
+}
+
+uint8_t Calibration_IsComplete(void)
+{
+    return 0;
+}
+
+ErrorCode Calibration_Save(void)
+{
+    return NO_ERROR;
+}
+
+ErrorCode Calibration_Clear(void)
+{
+    return NO_ERROR;
+}
+
+uint8_t Calibration_GetStatus(void)
+{
+    return 0;
+}
+
+void Capture_Start(LIS3DH_Handle* sensors, uint8_t sensor_count, uint8_t threshold)
+{
+}
+
+void Capture_Stop(void)
+{
+}
+
+void Capture_Task(void)
+{
+}
+
+void Stream_Pump(void)
+{
+}
+
+uint32_t Stream_GetStallCycles(void)
+{
+    return 0;
+}
+
+uint16_t Stream_TxFree(void)
+{
+    return STREAM_TX_BUFFER_SIZE - 1;   // The UART is not the bottleneck under test
+}
+
+void Stream_SendAcc(uint8_t channel, const Calibration_Axis* axes, const uint8_t* AccData)
+{
+    now += sample_cycles;
+    encoded++;
+}
+
+void Stream_SendRaw(uint8_t channel, const uint8_t* AccData)
+{
+    now += sample_cycles;
+    encoded++;
+}
+
+void Stream_SendRaw8(uint8_t channel, const uint8_t* packed, uint8_t count)
+{
+    now += (uint64_t)sample_cycles * count;
+    encoded += count;
+}
+
+void Stream_SendTilt(uint8_t channel, int16_t pitch, int16_t roll)
+{
+    now += sample_cycles;
+    encoded++;
+}
+
+void Stream_SendImpact(uint8_t channel, uint16_t peak, uint16_t duration, uint32_t timestamp)
+{
+    now += BENCH_EVENT_CYCLES;
+}
+
+void Stream_SendAux(uint8_t channel, const int16_t* adc)
+{
+    now += BENCH_EVENT_CYCLES;
+}
+
+void Stream_SendFeatures(uint8_t channel, const Features_Axis* features)
+{
+    now += BENCH_EVENT_CYCLES;
+}
+
+void Stream_SendGap(uint8_t channel, uint8_t cause, uint32_t lost)
+{
+    now += BENCH_EVENT_CYCLES;
+}
+
+void Stream_SendEvent(uint8_t channel, uint8_t event, uint8_t value)
+{
+    now += BENCH_EVENT_CYCLES;
+}
+
+void Stream_SendSpectrum(uint8_t channel, uint8_t axis, const uint8_t* bins, uint8_t count)
+{
+    now += BENCH_EVENT_CYCLES;
+}
+
+/**
+*   \brief Run the acquisition for BENCH_SECONDS and return the samples encoded per second.
+*/
+static uint32_t Bench_Run(const BenchScenario* scenario, uint8_t sequential_loop,
+                          uint32_t cycles_per_sample, uint32_t* lost_per_s)
+{
+    static LIS3DH_Handle sensors[LIS3DH_MAX_DEVICES];
+    uint64_t end = (uint64_t)BENCH_SECONDS * BENCH_MHZ * 1000000u;
+
+    now = 0;
+    done_at = 0;
+    sequential = sequential_loop;
+    sample_cycles = cycles_per_sample;
+    load = scenario;
+    overwritten = 0;
+    for (uint8_t s = 0; s < load->sensors; s++)
+    {
+        LIS3DH_Init(&sensors[s], addresses[s], s);
+        LIS3DH_SetRegister(&sensors[s], LIS3DH_CTRL_REG1, load->odr | LIS3DH_CTRL_REG1_XYZ_EN);
+        LIS3DH_SetFifoMode(&sensors[s], LIS3DH_FIFO_MODE_STREAM);
+        LIS3DH_Commit(&sensors[s]);
+    }
+    Acquisition_Start(sensors, load->sensors);
+
+    // The FIFOs start empty when the acquisition starts
+    uint64_t start = now;
+    for (uint8_t s = 0; s < load->sensors; s++)
+    {
+        produced[s] = start * load->odr_hz / (BENCH_MHZ * 1000000u);
+    }
+    encoded = 0;
+    end += start;
+
+    while (now < end)
+    {
+        Acquisition_Task();
+        now += BENCH_LOOP_CYCLES;
+    }
+
+    *lost_per_s = (uint32_t)(overwritten / BENCH_SECONDS);
+    return (uint32_t)(encoded / BENCH_SECONDS);
+}
+
+int main(void)
+{
+    static const uint32_t costs[] = { 1000, 2000, 4000, 8000, 12000, 16000 };
+
+    for (uint8_t n = 0; n < sizeof(scenarios) / sizeof(scenarios[0]); n++)
+    {
+        printf("%u sensor(s) at %u Hz, I2C at %u kHz, %u MHz, %u s simulated\n",
+               scenarios[n].sensors, scenarios[n].odr_hz, I2C_Master_DATA_RATE, BENCH_MHZ, BENCH_SECONDS);
+        printf("cycles/sample | sequential samples/s lost/s | pipelined samples/s lost/s | gain\n");
+
+        for (uint8_t i = 0; i < sizeof(costs) / sizeof(costs[0]); i++)
+        {
+            uint32_t lost_seq, lost_pipe;
+            uint32_t seq = Bench_Run(&scenarios[n], 1, costs[i], &lost_seq);
+            uint32_t pipe = Bench_Run(&scenarios[n], 0, costs[i], &lost_pipe);
+
+            printf("%13u | %20u %6u | %19u %6u | %3u%%\n",
+                   costs[i], seq, lost_seq, pipe, lost_pipe, (pipe * 100u) / seq - 100u);
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
+
+/* [] END OF FILE */
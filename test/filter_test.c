@@ -0,0 +1,230 @@
+/*
+* This file includes the host test of the filter presets,
+* Filter_Process() checked against a double precision direct form I.
+*
+* Build and run from this folder with `make`, or:
+*   gcc -std=gnu99 -O2 -DRAM_CODE_ENABLE=0 -Ihost -I../AY1920_II_HW_05_PROJ_2.3.cydsn filter_test.c
+*       ../AY1920_II_HW_05_PROJ_2.3.cydsn/Filter.c -lm -o filter_test && ./filter_test
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "Acquisition.h"
+#include "Filter.h"
+
+#define TEST_FS_HZ 1344.0                   // Data rate of the presets
+#define TEST_AMPLITUDE 8000.0               // Sine of the sweeps, in LSB of the left aligned samples
+#define TEST_SETTLE_SAMPLES 4000            // Transient skipped before measuring
+#define TEST_MEASURE_SAMPLES 16000          // Samples of the correlation
+#define TEST_DC_VALUE 12345                 // Constant input of the DC gain
+#define TEST_CUTOFF_TOLERANCE 0.02          // Relative distance of the -3 dB point from the design
+#define TEST_REFERENCE_TOLERANCE_DB 0.1     // Fixed point against double, where the gain is above -60 dB
+
+/**
+*   \brief Preset under test.
+*/
+typedef struct {
+    const char* name;
+    const Filter_Biquad* sections;
+    uint8_t decimation;
+    double cutoff_hz;       // Design -3 dB point
+    double min_stop_db;     // Attenuation required at the Nyquist frequency of the output
+} TestPreset;
+
+static const Filter_Biquad lp50[2] = ACQ_FILTER_LP50_SECTIONS;
+static const Filter_Biquad lp30[2] = ACQ_FILTER_LP30_SECTIONS;
+
+static const TestPreset presets[] = {
+    { "lp50", lp50, 8, 50.0, 15.0 },
+    { "lp30", lp30, 12, 30.0, 15.0 },
+};
+
+/**
+*   \brief Double precision direct form I of a cascade.
+*/
+typedef struct {
+    const Filter_Biquad* sections;
+    double x[FILTER_MAX_STAGES][2];
+    double y[FILTER_MAX_STAGES][2];
+} Reference;
+
+static double Reference_Process(Reference* ref, double value)
+{
+    for (uint8_t s = 0; s < FILTER_MAX_STAGES; s++)
+    {
+        const Filter_Biquad* c = &ref->sections[s];
+        double* x = ref->x[s];
+        double* y = ref->y[s];
+        double out = (c->b0 * value + c->b1 * x[0] + c->b2 * x[1] - c->a1 * y[0] - c->a2 * y[1]) / (1 << FILTER_Q);
+
+        x[1] = x[0];
+        x[0] = value;
+        y[1] = y[0];
+        y[0] = out;
+        value = out;
+    }
+    return value;
+}
+
+/**
+*   \brief Same value on the three axes, in the format of the sensor.
+*/
+static void Test_Pack(int16_t value, uint8_t* sample)
+{
+    for (uint8_t axis = 0; axis < FILTER_AXES; axis++)
+    {
+        sample[2*axis] = (uint8_t)(value & 0xFF);
+        sample[2*axis+1] = (uint8_t)((uint16_t)value >> 8);
+    }
+}
+
+/**
+*   \brief Gain in dB of the preset at a frequency, from Filter_Process() and from the reference.
+*/
+static void Test_Gain(const TestPreset* preset, double hz, double* fixed_db, double* reference_db)
+{
+    Filter filter;
+    Reference ref = { preset->sections, { { 0 } }, { { 0 } } };
+    double fixed_i = 0, fixed_q = 0, ref_i = 0, ref_q = 0;
+
+    Filter_Init(&filter, preset->sections, FILTER_MAX_STAGES, 1);   // Every output, the decimation is checked apart
+
+    for (uint32_t n = 0; n < TEST_SETTLE_SAMPLES + TEST_MEASURE_SAMPLES; n++)
+    {
+        double phase = 2.0 * M_PI * hz * n / TEST_FS_HZ;
+        int16_t in = (int16_t)lround(TEST_AMPLITUDE * sin(phase));
+        uint8_t sample[LIS3DH_SAMPLE_SIZE];
+
+        Test_Pack(in, sample);
+        Filter_Process(&filter, sample, sample);
+        double fixed = (int16_t)(sample[0] | (sample[1] << 8));
+        double reference = Reference_Process(&ref, in);
+
+        if (n >= TEST_SETTLE_SAMPLES)
+        {
+            fixed_i += fixed * sin(phase);
+            fixed_q += fixed * cos(phase);
+            ref_i += reference * sin(phase);
+            ref_q += reference * cos(phase);
+        }
+    }
+
+    double scale = 2.0 / (TEST_MEASURE_SAMPLES * TEST_AMPLITUDE);
+    *fixed_db = 20.0 * log10(hypot(fixed_i, fixed_q) * scale);
+    *reference_db = 20.0 * log10(hypot(ref_i, ref_q) * scale);
+}
+
+/**
+*   \brief DC gain and decimation, 0 on success.
+*/
+static int Test_Dc(const TestPreset* preset)
+{
+    Filter filter;
+    uint32_t outputs = 0;
+    int16_t last = 0;
+
+    Filter_Init(&filter, preset->sections, FILTER_MAX_STAGES, preset->decimation);
+
+    for (uint32_t n = 0; n < TEST_SETTLE_SAMPLES; n++)
+    {
+        uint8_t sample[LIS3DH_SAMPLE_SIZE];
+
+        Test_Pack(TEST_DC_VALUE, sample);
+        if (Filter_Process(&filter, sample, sample))
+        {
+            outputs++;
+            last = (int16_t)(sample[0] | (sample[1] << 8));
+        }
+    }
+
+    int failures = 0;
+    if (outputs != TEST_SETTLE_SAMPLES / preset->decimation)
+    {
+        printf("%s: %u outputs from %u inputs\n", preset->name, outputs, TEST_SETTLE_SAMPLES);
+        failures++;
+    }
+    if (abs(last - TEST_DC_VALUE) > 1)
+    {
+        printf("%s: DC output %d for %d\n", preset->name, last, TEST_DC_VALUE);
+        failures++;
+    }
+    return failures;
+}
+
+/**
+*   \brief -3 dB point, stop band and agreement with the reference, 0 on success.
+*/
+static int Test_Response(const TestPreset* preset)
+{
+    int failures = 0;
+    double low = 1.0, high = TEST_FS_HZ / 2.0;
+    double fixed_db, reference_db;
+
+    // The -3 dB point of the fixed point filter, by bisection
+    for (uint8_t i = 0; i < 20; i++)
+    {
+        double middle = (low + high) / 2.0;
+
+        Test_Gain(preset, middle, &fixed_db, &reference_db);
+        if (fixed_db > -3.0103)
+        {
+            low = middle;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    double cutoff = (low + high) / 2.0;
+    if (fabs(cutoff - preset->cutoff_hz) > TEST_CUTOFF_TOLERANCE * preset->cutoff_hz)
+    {
+        printf("%s: -3 dB at %.2f Hz, designed for %.0f Hz\n", preset->name, cutoff, preset->cutoff_hz);
+        failures++;
+    }
+
+    // Aliased onto the band of the output after the decimation
+    double nyquist = TEST_FS_HZ / (2.0 * preset->decimation);
+    Test_Gain(preset, nyquist, &fixed_db, &reference_db);
+    double stop_db = -fixed_db;
+    if (stop_db < preset->min_stop_db)
+    {
+        printf("%s: %.1f dB at %.0f Hz, at least %.0f dB required\n", preset->name, stop_db, nyquist, preset->min_stop_db);
+        failures++;
+    }
+
+    // Sweep of the whole band against the double precision filter
+    double worst = 0;
+    for (double hz = 2.0; hz < TEST_FS_HZ / 2.0; hz *= 1.1)
+    {
+        Test_Gain(preset, hz, &fixed_db, &reference_db);
+        if (reference_db > -60.0 && fabs(fixed_db - reference_db) > worst)
+        {
+            worst = fabs(fixed_db - reference_db);
+        }
+    }
+    if (worst > TEST_REFERENCE_TOLERANCE_DB)
+    {
+        printf("%s: %.3f dB from the double precision filter\n", preset->name, worst);
+        failures++;
+    }
+
+    printf("%s: -3 dB at %.2f Hz, %.1f dB at %.0f Hz, within %.3f dB of the reference: %s\n",
+           preset->name, cutoff, stop_db, nyquist, worst, failures ? "FAIL" : "ok");
+    return failures;
+}
+
+int main(void)
+{
+    int failures = 0;
+
+    for (uint8_t p = 0; p < sizeof(presets) / sizeof(presets[0]); p++)
+    {
+        failures += Test_Dc(&presets[p]);
+        failures += Test_Response(&presets[p]);
+    }
+
+    return failures ? 1 : 0;
+}
+
+/* [] END OF FILE */
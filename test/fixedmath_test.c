@@ -0,0 +1,179 @@
+/*
+* This file includes the host test of the integer math helpers,
+* checked against the double precision functions of the C library.
+*
+* Build and run from this folder with `make`, or:
+*   gcc -std=gnu99 -O2 -Ihost -I../AY1920_II_HW_05_PROJ_2.3.cydsn fixedmath_test.c
+*       ../AY1920_II_HW_05_PROJ_2.3.cydsn/FixedMath.c -lm -o fixedmath_test && ./fixedmath_test
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include "FixedMath.h"
+
+#define TEST_ATAN2_MAX_ERROR_CDEG 1.0       // Bound of FixedMath.h, 0.01 degrees
+#define TEST_MAGNITUDE_MAX_ERROR 0.0001     // Relative error of the magnitude, on top of 1 LSB of rounding
+#define TEST_RANDOM_VECTORS 1000000
+
+static uint32_t seed = 1;
+
+/**
+*   \brief Deterministic pseudo random numbers, the same on every host.
+*/
+static uint32_t Test_Random(void)
+{
+    seed = seed * 1664525u + 1013904223u;
+    return seed;
+}
+
+/**
+*   \brief Random component from -range to range.
+*/
+static int32_t Test_Component(int32_t range)
+{
+    return (int32_t)(Test_Random() % (2u * (uint32_t)range + 1u)) - range;
+}
+
+/**
+*   \brief Check FixedMath_Sqrt() against floor(sqrt()), 0 on success.
+*/
+static int Test_Sqrt(void)
+{
+    static const uint32_t edges[] = { 0, 1, 2, 3, 4, 15, 16, 17, 65535, 65536,
+                                      0x3FFFFFFFu, 0x40000000u, 0xFFFE0001u, 0xFFFE0000u, 0xFFFFFFFFu };
+    int failures = 0;
+
+    for (uint32_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++)
+    {
+        uint16_t expected = (uint16_t)floor(sqrt((double)edges[i]));
+
+        if (FixedMath_Sqrt(edges[i]) != expected)
+        {
+            printf("FixedMath_Sqrt(%u) = %u, expected %u\n", edges[i], FixedMath_Sqrt(edges[i]), expected);
+            failures++;
+        }
+    }
+
+    // Every perfect square and its neighbours
+    for (uint32_t r = 1; r < 65536 && failures < 10; r++)
+    {
+        uint32_t square = r * r;
+
+        if (FixedMath_Sqrt(square) != r || FixedMath_Sqrt(square - 1) != r - 1)
+        {
+            printf("FixedMath_Sqrt() wrong around %u^2\n", r);
+            failures++;
+        }
+    }
+
+    for (uint32_t i = 0; i < TEST_RANDOM_VECTORS && failures < 10; i++)
+    {
+        uint32_t value = Test_Random();
+        uint16_t expected = (uint16_t)floor(sqrt((double)value));
+
+        if (FixedMath_Sqrt(value) != expected)
+        {
+            printf("FixedMath_Sqrt(%u) = %u, expected %u\n", value, FixedMath_Sqrt(value), expected);
+            failures++;
+        }
+    }
+
+    printf("FixedMath_Sqrt: %s\n", failures ? "FAIL" : "ok");
+    return failures;
+}
+
+/**
+*   \brief Check FixedMath_Atan2() against atan2() and hypot(), 0 on success.
+*/
+static int Test_Atan2(void)
+{
+    static const int32_t ranges[] = { 10, 1000, 2048, 100000, (1l << 30) - 1 };
+    double worst_angle = 0;
+    double worst_magnitude = 0;
+    int failures = 0;
+
+    for (uint8_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); r++)
+    {
+        for (uint32_t i = 0; i < TEST_RANDOM_VECTORS / 5; i++)
+        {
+            int32_t x = Test_Component(ranges[r]);
+            int32_t y = Test_Component(ranges[r]);
+            uint32_t magnitude;
+
+            if (x == 0 && y == 0)
+            {
+                continue;
+            }
+
+            int16_t angle = FixedMath_Atan2(y, x, &magnitude);
+            double error = fabs(angle - atan2(y, x) * 18000.0 / M_PI);
+            double length = hypot(x, y);
+
+            if (error > 18000.0)
+            {
+                error = 36000.0 - error;    // -18000 and 18000 are the same angle
+            }
+            if (error > worst_angle)
+            {
+                worst_angle = error;
+            }
+            if (error > TEST_ATAN2_MAX_ERROR_CDEG && failures < 10)
+            {
+                printf("FixedMath_Atan2(%d, %d) = %d, error %.3f cdeg\n", y, x, angle, error);
+                failures++;
+            }
+
+            // The magnitude is an integer, the rounding dominates the short vectors
+            double relative = (fabs(magnitude - length) - 1.0) / length;
+
+            if (relative > worst_magnitude)
+            {
+                worst_magnitude = relative;
+            }
+            if (relative > TEST_MAGNITUDE_MAX_ERROR && failures < 10)
+            {
+                printf("FixedMath_Atan2(%d, %d) magnitude %u, expected %.1f\n", y, x, magnitude, length);
+                failures++;
+            }
+        }
+    }
+
+    // The axes and the diagonals, where the quadrant is decided
+    static const int32_t axes[][3] = {
+        { 0, 1, 0 }, { 1, 0, 9000 }, { 0, -1, 18000 }, { -1, 0, -9000 },
+        { 1000, 1000, 4500 }, { 1000, -1000, 13500 }, { -1000, -1000, -13500 }, { -1000, 1000, -4500 },
+    };
+
+    for (uint8_t i = 0; i < sizeof(axes) / sizeof(axes[0]); i++)
+    {
+        int16_t angle = FixedMath_Atan2(axes[i][0], axes[i][1], NULL);
+        int32_t error = angle - axes[i][2];
+
+        if (error < 0)
+        {
+            error = -error;
+        }
+        if (error > 18000)
+        {
+            error = 36000 - error;
+        }
+        if (error > TEST_ATAN2_MAX_ERROR_CDEG)
+        {
+            printf("FixedMath_Atan2(%d, %d) = %d, expected %d\n", axes[i][0], axes[i][1], angle, axes[i][2]);
+            failures++;
+        }
+    }
+
+    printf("FixedMath_Atan2: worst angle error %.3f cdeg, worst magnitude error 1 LSB + %.5f%%: %s\n",
+           worst_angle, worst_magnitude * 100.0, failures ? "FAIL" : "ok");
+    return failures;
+}
+
+int main(void)
+{
+    int failures = Test_Sqrt() + Test_Atan2();
+
+    return failures ? 1 : 0;
+}
+
+/* [] END OF FILE */
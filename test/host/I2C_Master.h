@@ -0,0 +1,11 @@
+/*
+* Host replacement of the I2C_Master component, only its data rate is used.
+*/
+
+#ifndef __HOST_I2C_MASTER_H
+    #define __HOST_I2C_MASTER_H
+
+    #define I2C_Master_DATA_RATE 100u
+
+#endif
+/* [] END OF FILE */
@@ -0,0 +1,28 @@
+/*
+* Host replacement of the PSoC Creator types, for the tests built with gcc.
+*/
+
+#ifndef __HOST_CYTYPES_H
+    #define __HOST_CYTYPES_H
+
+    #include <stddef.h>
+    #include <stdint.h>
+
+    typedef uint8_t uint8;
+    typedef uint16_t uint16;
+    typedef uint32_t uint32;
+    typedef int8_t int8;
+    typedef int16_t int16;
+    typedef int32_t int32;
+    typedef float float32;
+    typedef volatile uint8_t reg8;
+
+    #define CY_SECTION(name) __attribute__((section(name)))
+    #define CY_ISR(name) void name(void)
+    #define CY_ISR_PROTO(name) void name(void)
+    #define LO8(x) ((uint8)((x) & 0xFFu))
+    #define HI8(x) ((uint8)(((x) >> 8) & 0xFFu))
+    #define CYBIT uint8
+
+#endif
+/* [] END OF FILE */
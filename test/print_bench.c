@@ -0,0 +1,206 @@
+/*
+* This file includes a host comparison of the lightweight text
+* output with snprintf, the formatter it replaced.
+*
+* Build and run from this folder with `make bench`, or:
+*   gcc -std=gnu99 -O2 -Ihost -I../AY1920_II_HW_05_PROJ_2.3.cydsn print_bench.c
+*       ../AY1920_II_HW_05_PROJ_2.3.cydsn/Print.c -o print_bench && ./print_bench
+*
+* The stream is replaced by a copy into a flat buffer, the same work the
+* ring does, and snprintf writes into a message buffer that is then
+* copied the same way, as the firmware did before Print.h. Every value is
+* first checked to give the same text with both. The times are of the
+* host CPU, so only the ratio is meaningful for the Cortex-M3; the flash
+* size of the formatter of newlib is only known from the map file of a
+* PSoC Creator build.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "Print.h"
+#include "Stream.h"
+
+#define BENCH_ROUNDS 2000000
+#define BENCH_MESSAGE_SIZE 64   // Message buffer of the firmware before Print.h
+
+static char output[256];        // Text queued since the last reset
+static uint16_t length;
+
+// Components used by the text output
+
+void Stream_Write(const uint8_t* data, uint8_t count)
+{
+    if (length + count >= sizeof(output))
+    {
+        length = 0;
+    }
+    memcpy(&output[length], data, count);
+    length += count;
+    output[length] = '\0';
+}
+
+/**
+*   \brief Queue a message formatted by snprintf, as before Print.h.
+*/
+static void Bench_Queue(const char* message)
+{
+    Stream_Write((const uint8_t*)message, (uint8_t)strlen(message));
+}
+
+static void Snprintf_Dec(int32_t value)
+{
+    char message[BENCH_MESSAGE_SIZE];
+
+    snprintf(message, sizeof(message), "%ld", (long)value);
+    Bench_Queue(message);
+}
+
+static void Snprintf_Hex(uint32_t value, uint8_t digits)
+{
+    char message[BENCH_MESSAGE_SIZE];
+
+    snprintf(message, sizeof(message), "%0*lX", digits, (unsigned long)value & (0xFFFFFFFFul >> (32 - 4 * digits)));
+    Bench_Queue(message);
+}
+
+static void Snprintf_Fixed(int32_t value, uint8_t decimals)
+{
+    char message[BENCH_MESSAGE_SIZE];
+    uint32_t magnitude = (value < 0) ? -(uint32_t)value : (uint32_t)value;
+    uint32_t scale = 1;
+
+    for (uint8_t i = 0; i < decimals; i++)
+    {
+        scale *= 10;
+    }
+    snprintf(message, sizeof(message), "%s%lu.%0*lu", (value < 0) ? "-" : "",
+             (unsigned long)(magnitude / scale), decimals, (unsigned long)(magnitude % scale));
+    Bench_Queue(message);
+}
+
+static const int32_t values[] = { 0, 7, -7, 42, -1234, 99999, 1000000, -20480, INT32_MAX, INT32_MIN };
+
+/**
+*   \brief Text of the last call, after clearing the output.
+*/
+static const char* Bench_Text(void)
+{
+    static char text[sizeof(output)];
+
+    strcpy(text, output);
+    length = 0;
+    output[0] = '\0';
+    return text;
+}
+
+/**
+*   \brief Check that both formatters give the same text, 0 on success.
+*/
+static int Bench_Check(void)
+{
+    int failures = 0;
+    char expected[sizeof(output)];
+
+    for (uint8_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+    {
+        Snprintf_Dec(values[i]);
+        strcpy(expected, Bench_Text());
+        Print_Dec(values[i]);
+        if (strcmp(expected, Bench_Text()) != 0)
+        {
+            printf("Print_Dec(%ld) differs from \"%s\"\n", (long)values[i], expected);
+            failures++;
+        }
+
+        Snprintf_Hex((uint32_t)values[i], 8);
+        strcpy(expected, Bench_Text());
+        Print_Hex((uint32_t)values[i], 8);
+        if (strcmp(expected, Bench_Text()) != 0)
+        {
+            printf("Print_Hex(%ld, 8) differs from \"%s\"\n", (long)values[i], expected);
+            failures++;
+        }
+
+        Snprintf_Fixed(values[i], 3);
+        strcpy(expected, Bench_Text());
+        Print_Fixed(values[i], 3);
+        if (strcmp(expected, Bench_Text()) != 0)
+        {
+            printf("Print_Fixed(%ld, 3) differs from \"%s\"\n", (long)values[i], expected);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+/**
+*   \brief Nanoseconds of a call of a formatter, averaged over the values.
+*/
+static double Bench_Time(void (*format)(int32_t))
+{
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t n = 0; n < BENCH_ROUNDS; n++)
+    {
+        format(values[n % (sizeof(values) / sizeof(values[0]))]);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec)) / BENCH_ROUNDS;
+}
+
+// Calls with the same signature, for the timing
+
+static void Print_Hex8(int32_t value)
+{
+    Print_Hex((uint32_t)value, 8);
+}
+
+static void Snprintf_Hex8(int32_t value)
+{
+    Snprintf_Hex((uint32_t)value, 8);
+}
+
+static void Print_Fixed3(int32_t value)
+{
+    Print_Fixed(value, 3);
+}
+
+static void Snprintf_Fixed3(int32_t value)
+{
+    Snprintf_Fixed(value, 3);
+}
+
+int main(void)
+{
+    if (Bench_Check() != 0)
+    {
+        return 1;
+    }
+
+    static const struct {
+        const char* name;
+        void (*print)(int32_t);
+        void (*reference)(int32_t);
+    } calls[] = {
+        { "Print_Dec", Print_Dec, Snprintf_Dec },
+        { "Print_Hex(8)", Print_Hex8, Snprintf_Hex8 },
+        { "Print_Fixed(3)", Print_Fixed3, Snprintf_Fixed3 },
+    };
+
+    printf("same text as snprintf for %u values\n", (unsigned)(sizeof(values) / sizeof(values[0])));
+    printf("call           |  Print ns | snprintf ns | ratio\n");
+    for (uint8_t i = 0; i < sizeof(calls) / sizeof(calls[0]); i++)
+    {
+        double print = Bench_Time(calls[i].print);
+        double reference = Bench_Time(calls[i].reference);
+
+        printf("%-14s | %9.1f | %11.1f | %5.1fx\n", calls[i].name, print, reference, reference / print);
+    }
+
+    return 0;
+}
+
+/* [] END OF FILE */